@@ -8,6 +8,8 @@
 #include <openframe/App/Application.h>
 #include <stomp/StompStats.h>
 
+#include "MemcachedController.h"
+
 namespace aprscreate {
 /**************************************************************************
  ** General Defines                                                      **
@@ -16,6 +18,12 @@ namespace aprscreate {
 /**************************************************************************
  ** Structures                                                           **
  **************************************************************************/
+  class LocalBackend;
+  class ConcurrentCache;
+  class SingleFlight;
+  class Suppress;
+  class Dispatcher;
+  class Brokers;
   class App : public openframe::App::Application {
     public:
       typedef openframe::App::Application super;
@@ -54,11 +62,31 @@ namespace aprscreate {
       static void *WorkerThread(void *arg);
 
       stomp::StompStats *stats() { return _stats; }
+      LocalBackend *local_backend() { return _local_backend; }
+      ConcurrentCache *shared_cache() { return _shared_cache; }
+      SingleFlight *single_flight() { return _single_flight; }
+      Suppress *suppress() { return _suppress; }
+      MemcachedController *memcached_pool() { return _memcached_pool; }
+      Dispatcher *dispatcher() { return _dispatcher; }
+      Brokers *brokers() { return _brokers; }
+      const MemcachedController::memcached_opts_t &memcached_opts() const { return _memcached_opts; }
+      // readable once we're shutting down, idle workers wait on it
+      int wakeup_fd() const { return _wakeup_fd; }
+      void wakeup();
 
     protected:
     private:
       workers_t _workers;
       stomp::StompStats *_stats;
+      LocalBackend *_local_backend;
+      ConcurrentCache *_shared_cache;
+      SingleFlight *_single_flight;
+      Suppress *_suppress;
+      MemcachedController *_memcached_pool;
+      Dispatcher *_dispatcher;
+      Brokers *_brokers;
+      MemcachedController::memcached_opts_t _memcached_opts;
+      int _wakeup_fd;
   }; // App
 
 /**************************************************************************
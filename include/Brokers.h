@@ -0,0 +1,150 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_BROKERS_H
+#define APRSCREATE_BROKERS_H
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+#include <openstats/StatsClient_Interface.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // What every worker knows about the stomp hosts, shared by all of them.
+  // A thread of our own times a TCP connect to each host now and then and
+  // keeps a moving average, workers build their connections from hosts()
+  // so the quickest broker that's up is tried first.  Workers tell us how
+  // their own connects go, a host that fails them is treated as down
+  // until a probe gets through to it again.
+  class Brokers : public openframe::LogObject,
+                  public openstats::StatsClient_Interface {
+    public:
+      // ### Type Definitions ###
+      struct broker_t {
+        std::string host;
+        std::string name;		// host:port with the separators made safe for stats
+        double rtt;			// ms, moving average of probes and connects
+        bool up;
+        bool probed;
+        unsigned int probes;
+        unsigned int connects;
+        unsigned int disconnects;
+        unsigned int failures;
+        double connect_ms;		// ms, last stomp connect
+      }; // broker_t
+
+      typedef std::vector<broker_t> brokersType;
+
+      // ### Constants ### //
+      static const time_t kDefaultProbeInterval;
+      static const int kDefaultProbeTimeout;
+      static const int kDefaultBackoffMin;
+      static const int kDefaultBackoffMax;
+      static const double kDefaultRttWeight;
+      static const time_t kDefaultReportInterval;
+
+      Brokers(const std::string &hosts,
+              const openframe::LogObject::thread_id_t thread_id=0);
+      virtual ~Brokers();
+
+      void onDescribeStats();
+      void onDestroyStats();
+
+      // seconds between probe rounds, 0 never probes and only what workers
+      // report is used
+      Brokers &set_probe_interval(const time_t probe_interval) {
+        _probe_interval = probe_interval;
+        return *this;
+      } // set_probe_interval
+
+      Brokers &set_probe_timeout(const int probe_timeout) {
+        _probe_timeout = probe_timeout;
+        return *this;
+      } // set_probe_timeout
+
+      // reconnect waits in ms, doubling per failed attempt up to max
+      Brokers &set_backoff(const int backoff_min, const int backoff_max) {
+        _backoff_min = backoff_min;
+        _backoff_max = backoff_max;
+        return *this;
+      } // set_backoff
+
+      void start();
+      void stop();
+
+      // ### Members ###
+      const std::string hosts();
+      const std::string standby(const std::string &primary);
+      size_t size() const { return _brokers.size(); }
+      int backoff(const unsigned int attempt, unsigned int &seed) const;
+
+      void connected(const std::string &host, const double ms);
+      void disconnected(const std::string &host);
+      void failed(const std::string &host);
+      void snapshot(brokersType &brokers);
+
+      static void *ProbeThread(void *arg);
+
+    protected:
+      void loop();
+      void probe();
+      double probe(const std::string &host);
+      void try_stats();
+      broker_t *find(const std::string &host);
+      void ordered(std::vector<const broker_t *> &ret);
+      void wait(const time_t seconds);
+
+    private:
+      pthread_t _thread;
+      pthread_mutex_t _lock;		// guards _brokers
+      brokersType _brokers;
+      time_t _probe_interval;
+      int _probe_timeout;
+      int _backoff_min;
+      int _backoff_max;
+      brokersType _reported;		// counters as of the last stomp report
+      time_t _last_report_at;
+      bool _started;
+      bool _done;
+  }; // class Brokers
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -0,0 +1,122 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#ifndef APRSCREATE_CIRCUITBREAKER_H
+#define APRSCREATE_CIRCUITBREAKER_H
+
+#include <string>
+#include <deque>
+
+#include <openframe/openframe.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Guards calls to a flaky dependency.  Closed lets everything through
+  // and watches the error rate over the last few calls, counting slow
+  // calls as errors.  Too many and it opens, failing calls fast for a
+  // backoff that doubles on each consecutive trip.  Once the backoff is
+  // up it goes half open and lets a few trial calls through; they all
+  // succeed and it closes again, any fail and it reopens.
+  class CircuitBreaker : public openframe::LogObject {
+    public:
+      // ### Type Definitions ###
+      enum breakerStateEnum {
+        breakerStateClosed		= 0,
+        breakerStateHalfOpen		= 1,
+        breakerStateOpen		= 2
+      }; // breakerStateEnum
+
+      struct breaker_opts_t {
+        double error_rate;		// percent of the window failing to trip
+        double slow;			// seconds before a call counts as failed
+        unsigned int window;		// calls to judge the error rate over
+        unsigned int min_calls;		// don't judge on fewer than this
+        double backoff;			// seconds open after the first trip
+        double backoff_max;		// cap for the doubling
+        unsigned int trials;		// successes needed while half open
+      }; // breaker_opts_t
+
+      typedef std::deque<bool> windowType;
+
+      // ### Constants ### //
+      static const double kDefaultErrorRate;
+      static const double kDefaultSlow;
+      static const unsigned int kDefaultWindow;
+      static const unsigned int kDefaultMinCalls;
+      static const double kDefaultBackoff;
+      static const double kDefaultBackoffMax;
+      static const unsigned int kDefaultTrials;
+
+      CircuitBreaker(const openframe::LogObject::thread_id_t thread_id, const std::string &name);
+      virtual ~CircuitBreaker();
+
+      static void init_opts(breaker_opts_t &opts);
+      CircuitBreaker &set_opts(const breaker_opts_t &opts) {
+        _opts = opts;
+        return *this;
+      } // set_opts
+
+      // ### Members ###
+      bool allow();
+      void record(const bool ok, const double elapsed);
+
+      breakerStateEnum state() const { return _state; }
+      unsigned int trips() const { return _trips; }
+
+    protected:
+      void trip();
+      void close();
+      static double now();
+
+    private:
+      std::string _name;
+      breaker_opts_t _opts;
+      breakerStateEnum _state;
+      windowType _window;
+      unsigned int _window_errors;
+      double _backoff;
+      double _open_until;
+      unsigned int _trial_calls;
+      unsigned int _trial_successes;
+      unsigned int _trips;
+  }; // class CircuitBreaker
+
+  std::ostream &operator<<(std::ostream &ss, const CircuitBreaker::breakerStateEnum state);
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
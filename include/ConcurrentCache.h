@@ -0,0 +1,105 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#ifndef APRSCREATE_CONCURRENTCACHE_H
+#define APRSCREATE_CONCURRENTCACHE_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <time.h>
+#include <pthread.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Process wide key/value cache with expiry, shared by every worker.
+  // Keys hash onto a fixed number of shards each behind its own lock so
+  // workers only contend when they hit the same shard.  Takes the place
+  // of memcached when there is only the one process to share with.  A
+  // full shard drops whatever was written longest ago.
+  class ConcurrentCache {
+    public:
+      // ### Type Definitions ###
+      typedef std::list<std::string> orderType;
+
+      struct cache_entry_t {
+        std::string value;
+        time_t expire_at;
+        orderType::iterator order;
+      }; // cache_entry_t
+
+      typedef std::map<std::string, cache_entry_t> entriesType;
+      typedef entriesType::size_type entriesSizeType;
+
+      struct cache_shard_t {
+        pthread_mutex_t lock;
+        entriesType entries;
+        orderType order;		// oldest write at the front
+      }; // cache_shard_t
+
+      typedef std::vector<cache_shard_t *> shardsType;
+
+      // ### Constants ### //
+      static const unsigned int kDefaultShards;
+      static const entriesSizeType kDefaultMaxSize;
+
+      ConcurrentCache(const unsigned int num_shards=kDefaultShards,
+                      const entriesSizeType max_size=kDefaultMaxSize);
+      virtual ~ConcurrentCache();
+
+      // ### Members ###
+      bool get(const std::string &ns, const std::string &key, std::string &value);
+      void put(const std::string &ns, const std::string &key, const std::string &value, const time_t ttl);
+      void erase(const std::string &ns, const std::string &key);
+      entriesSizeType size();
+
+      const unsigned int num_shards() const { return _shards.size(); }
+
+    protected:
+      cache_shard_t *shard(const std::string &key) const;
+      void remove(cache_shard_t *s, entriesType::iterator ptr);
+
+    private:
+      shardsType _shards;
+      entriesSizeType _max_shard_size;
+  }; // class ConcurrentCache
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -24,9 +24,18 @@
 #ifndef APRSCREATE_DBI_H
 #define APRSCREATE_DBI_H
 
+#include <map>
+#include <set>
+#include <string>
+#include <sstream>
+
+#include <math.h>
+
 #include <openframe/DBI.h>
 #include <aprs/APRS.h>
 
+#include "StoreBackend.h"
+
 namespace aprscreate {
 
 /**************************************************************************
@@ -40,17 +49,88 @@ namespace aprscreate {
  ** Structures                                                           **
  **************************************************************************/
 
- class DBI : public openframe::DBI {
+ class DBI : public openframe::LogObject,
+             public StoreBackend {
     public:
+      // same result types as openframe's so the StoreBackend signatures
+      // line up, the connection itself is our own below
+      typedef openframe::DBI::resultType resultType;
+      typedef openframe::DBI::resultSizeType resultSizeType;
+      typedef openframe::DBI::simpleResultType simpleResultType;
+      typedef openframe::DBI::simpleResultSizeType simpleResultSizeType;
+
+      static const double kDefaultSlowQuery;
+      static const unsigned int kDefaultTimeout;
+      static const unsigned int kNumLatencyBuckets = 9;
+      static const double kLatencyBuckets[kNumLatencyBuckets];
+
+      // Parameters for a query, kept as text alongside so slow
+      // queries can be logged with what they were called with.
+      struct query_params_t {
+        mysqlpp::SQLQueryParms parms;
+        std::stringstream text;
+
+        template<typename T>
+        query_params_t &operator<<(const T &value) {
+          parms << mysqlpp::SQLTypeAdapter(value);
+          if (text.tellp() > 0) text << ", ";
+          text << value;
+          return *this;
+        } // operator<<
+      }; // query_params_t
+
+      struct query_stats_t {
+        unsigned int calls;
+        unsigned int errors;
+        unsigned int slow;
+        double total;
+        double max;
+        unsigned int buckets[kNumLatencyBuckets];
+      }; // query_stats_t
+
+      typedef std::map<std::string, query_stats_t> queryStatsType;
+      typedef std::map<std::string, mysqlpp::Query *> queriesType;
+
       DBI(const openframe::LogObject::thread_id_t thread_id,
-                 const std::string &db,
                  const std::string &host,
                  const std::string &user,
-                 const std::string &pass);
+                 const std::string &pass,
+                 const std::string &db);
       virtual ~DBI();
 
+      // our own connection instead of openframe's so the socket gets
+      // timeouts, a stalled server then fails the call instead of
+      // blocking the worker
+      DBI &init();
       void prepare_queries();
 
+      // seconds to connect, read or write before the call fails, mysql
+      // may retry a read once or twice so a stall can run a bit longer
+      DBI &set_timeout(const double timeout) {
+        _timeout = timeout < 1 ? 1 : (unsigned int) ceil(timeout);
+        return *this;
+      } // set_timeout
+
+      // the last call failed because the server didn't answer in time or
+      // couldn't be reached
+      bool is_timeout() const { return _timed_out; }
+
+      // the procedure isn't installed, it isn't called again after the
+      // first try so the caller can do without it
+      bool is_missing(const std::string &name) const { return _missing.count(name) > 0; }
+
+      DBI &set_slow_query(const double slow_query) {
+        _slow_query = slow_query;
+        return *this;
+      } // set_slow_query
+
+      const queryStatsType &query_stats() const { return _query_stats; }
+      void clear_query_stats();
+
+      static void init_query_stats(query_stats_t &stats);
+      static void merge_query_stats(query_stats_t &to, const query_stats_t &from);
+      static double percentile_query_stats(const query_stats_t &stats, const double pct);
+
       bool isUserVerified(const std::string &callsign);
       bool getUserMsgChecksum(const std::string &id, const std::string &callsign, const std::string &key);
       DBI::simpleResultSizeType setUserMsgChecksum(const std::string &id,
@@ -62,21 +142,48 @@ namespace aprscreate {
 
 
       bool isUserSession(const std::string &callsign, const time_t start_ts);
+      DBI::resultSizeType getActiveSessions(const time_t start_ts, StoreResult &res);
+      DBI::resultSizeType getSessionsFor(const std::vector<std::string> &callsigns,
+                                         const time_t start_ts,
+                                         StoreResult &res);
       DBI::resultSizeType getLastMessageId(const std::string &source, std::string &id);
       DBI::resultSizeType getMessageDecayId(const std::string &source, const std::string &target,
                                             const std::string &msgack, std::string &id);
       DBI::resultSizeType getObjectDecayId(const std::string &name, const time_t start_ts, std::string &id);
-      DBI::resultSizeType getPendingMessages(DBI::resultType &res);
+      DBI::resultSizeType getPendingMessages(StoreResult &res);
       DBI::simpleResultSizeType setMessageAck(const std::string &source, const std::string &target,
                                               const std::string &msgack);
       DBI::simpleResultSizeType setMessageSent(const int id, const std::string &decay_id, const time_t broadcast_ts);
       DBI::simpleResultSizeType setMessageError(const int id);
-      DBI::resultSizeType getPendingObjects(const time_t now, DBI::resultType &res);
+      DBI::resultSizeType getPendingObjects(const time_t now, StoreResult &res);
       DBI::simpleResultSizeType setObjectSent(const int id, const std::string &decay_id, const time_t broadcast_ts);
       DBI::simpleResultSizeType setObjectError(const int id);
-      DBI::resultSizeType getPendingPositions(DBI::resultType &res);
+      DBI::resultSizeType getPendingPositions(StoreResult &res);
       DBI::simpleResultSizeType setPositionSent(const int id, const time_t broadcast_ts);
       DBI::simpleResultSizeType setPositionError(const int id);
+
+    protected:
+      bool connect();
+      void track_query(const std::string &name, const std::string &sql);
+      bool store(const std::string &name, query_params_t &params, resultType &res);
+      bool execute(const std::string &name, query_params_t &params, simpleResultType &res);
+      void record(const std::string &name, const query_params_t &params, const double elapsed, const bool ok);
+      bool first_field(const std::string &name, const resultType &res, const char *column, std::string &ret);
+      static void to_result(const resultType &from, StoreResult &to);
+
+    private:
+      mysqlpp::Connection *_sqlpp;
+      queriesType _queries;
+      queryStatsType _query_stats;
+      std::set<std::string> _missing;
+      double _slow_query;
+      unsigned int _timeout;
+      bool _timed_out;
+
+      std::string _db;
+      std::string _host;
+      std::string _user;
+      std::string _pass;
   }; // class DBI
 
 /**************************************************************************
@@ -0,0 +1,154 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_DISPATCHER_H
+#define APRSCREATE_DISPATCHER_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <pthread.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Hands frames read by one worker out to all of them so a topic is
+  // consumed once per process instead of once per worker.  Each worker
+  // owns a shard, a queue behind its own lock with an eventfd that's
+  // readable while the queue has something in it.
+  //
+  // Frames are keyed by callsign and a callsign sticks to one shard so
+  // its frames are handled in order and its cache entries live in one
+  // worker.  A key only ever moves, to a less loaded shard on push or to
+  // an idle worker that steals it, while none of its frames are being
+  // worked on, so moving never reorders a station.
+  //
+  // The reader doesn't ack a frame when it queues it.  Whatever it needs
+  // for the ack rides along with the entry and comes back out of
+  // finished() once the owner is done() with it, so a frame still queued
+  // when we stop or crash is delivered again.
+  class Dispatcher {
+    public:
+      // ### Type Definitions ###
+      struct dispatch_ack_t {
+        std::string message_id;	// empty for nothing to ack
+        std::string subscription;
+        unsigned int generation;	// connection it came in on
+      }; // dispatch_ack_t
+
+      struct dispatch_entry_t {
+        std::string key;
+        std::string body;
+        double timestamp;	// when the producer sent it, 0 if unknown
+        dispatch_ack_t ack;
+      }; // dispatch_entry_t
+
+      typedef std::deque<dispatch_entry_t> entriesType;
+      typedef entriesType::size_type entriesSizeType;
+      typedef std::map<std::string, unsigned int> countsType;
+      typedef std::map<std::string, unsigned int> routesType;
+      typedef std::vector<dispatch_ack_t> acksType;
+
+      struct dispatch_shard_t {
+        pthread_mutex_t lock;
+        entriesType queue;
+        countsType queued;		// key => entries waiting in queue
+        countsType pending;		// key => queued plus popped and not done
+        entriesSizeType depth;		// queue.size(), readable without the lock
+        int ready_fd;
+        unsigned int pushed;
+        unsigned int popped;
+        unsigned int stolen;		// entries this shard took from others
+        unsigned int moved;		// keys rerouted here on push
+        entriesSizeType max_depth;	// high water mark since the last stats()
+      }; // dispatch_shard_t
+
+      typedef std::vector<dispatch_shard_t *> shardsType;
+
+      struct dispatch_stats_t {
+        unsigned int pushed;
+        unsigned int popped;
+        unsigned int stolen;
+        unsigned int moved;
+        entriesSizeType depth;
+        entriesSizeType max_depth;
+      }; // dispatch_stats_t
+
+      // ### Constants ### //
+      static const entriesSizeType kDefaultRebalanceDepth;
+
+      Dispatcher(const unsigned int num_shards,
+                 const entriesSizeType rebalance_depth=kDefaultRebalanceDepth);
+      virtual ~Dispatcher();
+
+      // ### Members ###
+      unsigned int push(const std::string &key, const std::string &body, const double timestamp=0);
+      unsigned int push(const std::string &key,
+                        const std::string &body,
+                        const double timestamp,
+                        const dispatch_ack_t &ack);
+      entriesSizeType pop(const unsigned int shard, entriesType &out, const entriesSizeType max);
+      void done(const unsigned int shard, const entriesType &entries);
+      size_t finished(acksType &ret);
+      entriesSizeType steal(const unsigned int shard);
+      entriesSizeType depth(const unsigned int shard);
+      void stats(const unsigned int shard, dispatch_stats_t &ret);
+
+      int ready_fd(const unsigned int shard) const { return _shards[shard % _shards.size()]->ready_fd; }
+      // readable while finished() has acks waiting
+      int acks_fd() const { return _acks_fd; }
+      const unsigned int num_shards() const { return _shards.size(); }
+
+    protected:
+      unsigned int hash(const std::string &key) const;
+      unsigned int route(const std::string &key);
+      void append(dispatch_shard_t *s, const dispatch_entry_t &entry);
+      void ready(dispatch_shard_t *s);
+
+    private:
+      pthread_mutex_t _route_lock;	// taken before any shard lock
+      routesType _routes;		// keys that don't live where they hash
+      shardsType _shards;
+      entriesSizeType _rebalance_depth;
+      pthread_mutex_t _acks_lock;
+      acksType _acks;			// done with, waiting on the reader
+      int _acks_fd;
+  }; // class Dispatcher
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
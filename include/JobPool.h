@@ -0,0 +1,99 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_JOBPOOL_H
+#define APRSCREATE_JOBPOOL_H
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  class Job {
+    public:
+      Job() { };
+      virtual ~Job() { };
+
+      virtual void run() = 0;
+  }; // class Job
+
+  // Fixed set of threads that run a batch of jobs to completion.  The
+  // calling thread works the batch alongside the pool and run() only
+  // returns once every job has finished, so results can be consumed in
+  // order right after.
+  class JobPool : public openframe::LogObject {
+    public:
+      // ### Type Definitions ###
+      typedef std::vector<Job *> jobsType;
+      typedef jobsType::size_type jobsSizeType;
+      typedef std::vector<pthread_t> threadsType;
+
+      JobPool(const openframe::LogObject::thread_id_t thread_id, const unsigned int num_threads);
+      virtual ~JobPool();
+
+      // ### Members ###
+      void start();
+      void stop();
+      void run(jobsType &jobs);
+      const unsigned int size() const { return _num_threads; }
+
+      static void *PoolThread(void *arg);
+
+    protected:
+      bool next(jobsType *&jobs, jobsSizeType &i);
+      void finish();
+
+    private:
+      pthread_mutex_t _lock;
+      pthread_cond_t _work_cond;
+      pthread_cond_t _done_cond;
+
+      threadsType _threads;
+      unsigned int _num_threads;
+
+      jobsType *_jobs;
+      jobsSizeType _next;
+      jobsSizeType _pending;
+      bool _done;
+  }; // class JobPool
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -0,0 +1,159 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_LOCALBACKEND_H
+#define APRSCREATE_LOCALBACKEND_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+
+#include "StoreBackend.h"
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // In process engine for single box deployments and load tests.  Keeps
+  // everything in memory and is shared by every worker's Store, rows are
+  // claimed when handed out so no two workers send the same one.
+  class LocalBackend : public openframe::LogObject,
+                       public StoreBackend {
+    public:
+      // ### Type Definitions ###
+      typedef std::map<std::string, std::string> fieldsType;
+      typedef std::vector<std::string> columnsType;
+
+      enum rowStateEnum {
+        rowStatePending		= 0,
+        rowStateClaimed		= 1,
+        rowStateSent		= 2,
+        rowStateError		= 3,
+        rowStateDone		= 4
+      }; // rowStateEnum
+
+      struct local_row_t {
+        rowStateEnum state;
+        time_t claimed_at;
+        fieldsType fields;
+      }; // local_row_t
+
+      typedef std::map<int, local_row_t> rowsType;
+      typedef std::map<std::string, time_t> sessionsType;
+      typedef std::set<std::string> stringSetType;
+      typedef std::map<std::string, std::string> stringMapType;
+
+      static const time_t kDefaultClaimTtl;
+      static const time_t kDefaultSentTtl;
+
+      LocalBackend(const openframe::LogObject::thread_id_t thread_id=0);
+      virtual ~LocalBackend();
+
+      // ### Loading ### //
+      size_t load(const std::string &filename);
+      bool add(const std::string &type, const fieldsType &fields);
+      int add_message(const fieldsType &fields);
+      int add_object(const fieldsType &fields);
+      int add_position(const fieldsType &fields);
+      void add_session(const std::string &callsign, const time_t active_ts);
+      void add_verify(const std::string &id, const std::string &callsign, const std::string &key);
+
+      // ### StoreBackend ### //
+      bool isUserVerified(const std::string &callsign);
+      bool getUserMsgChecksum(const std::string &id, const std::string &callsign, const std::string &key);
+      openframe::DBI::simpleResultSizeType setUserMsgChecksum(const std::string &id,
+                                                             const std::string &callsign,
+                                                             const std::string &key);
+      openframe::DBI::simpleResultSizeType setTryUserVerify(const std::string &id,
+                                                           const std::string &callsign,
+                                                           const std::string &key);
+
+      bool isUserSession(const std::string &callsign, const time_t start_ts);
+      openframe::DBI::resultSizeType getActiveSessions(const time_t start_ts, StoreResult &res);
+      openframe::DBI::resultSizeType getSessionsFor(const std::vector<std::string> &callsigns,
+                                                    const time_t start_ts,
+                                                    StoreResult &res);
+      openframe::DBI::resultSizeType getLastMessageId(const std::string &source, std::string &id);
+      openframe::DBI::resultSizeType getMessageDecayId(const std::string &source, const std::string &target,
+                                                       const std::string &msgack, std::string &id);
+      openframe::DBI::resultSizeType getObjectDecayId(const std::string &name, const time_t start_ts, std::string &id);
+      openframe::DBI::resultSizeType getPendingMessages(StoreResult &res);
+      openframe::DBI::simpleResultSizeType setMessageAck(const std::string &source, const std::string &target,
+                                                         const std::string &msgack);
+      openframe::DBI::simpleResultSizeType setMessageSent(const int id, const std::string &decay_id, const time_t broadcast_ts);
+      openframe::DBI::simpleResultSizeType setMessageError(const int id);
+      openframe::DBI::resultSizeType getPendingObjects(const time_t now, StoreResult &res);
+      openframe::DBI::simpleResultSizeType setObjectSent(const int id, const std::string &decay_id, const time_t broadcast_ts);
+      openframe::DBI::simpleResultSizeType setObjectError(const int id);
+      openframe::DBI::resultSizeType getPendingPositions(StoreResult &res);
+      openframe::DBI::simpleResultSizeType setPositionSent(const int id, const time_t broadcast_ts);
+      openframe::DBI::simpleResultSizeType setPositionError(const int id);
+
+    protected:
+      int insert(rowsType &rows, const fieldsType &fields);
+      bool claim(local_row_t &row, const time_t now);
+      static bool matches_msgack(local_row_t &row, const std::string &msgack);
+      bool purge(rowsType &rows, rowsType::iterator &ptr, const time_t now);
+      openframe::DBI::simpleResultSizeType set_state(rowsType &rows, const int id, const rowStateEnum state);
+      static void init_result(const columnsType &columns, StoreResult &res);
+      static void to_result(const local_row_t &row, const columnsType &columns, StoreResult &res);
+      static void to_columns(const char *list, columnsType &columns);
+
+    private:
+      pthread_mutex_t _lock;
+
+      int _next_id;
+      rowsType _messages;
+      rowsType _objects;
+      rowsType _positions;
+      sessionsType _sessions;
+      stringSetType _verified;
+      stringSetType _checksums;
+      stringMapType _verify_keys;
+
+      columnsType _message_columns;
+      columnsType _object_columns;
+      columnsType _position_columns;
+  }; // class LocalBackend
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+
+} // namespace aprscreate
+#endif
@@ -0,0 +1,99 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#ifndef APRSCREATE_LRUCACHE_H
+#define APRSCREATE_LRUCACHE_H
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <time.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Small bounded cache with per entry expiry, least recently used goes
+  // first when full.  Entries are either positive, carrying a value, or
+  // negative, remembering that there was nothing to find.  Not thread
+  // safe, each Store keeps its own.
+  class LruCache {
+    public:
+      // ### Type Definitions ###
+      struct lru_entry_t {
+        std::string key;
+        std::string value;
+        bool positive;
+        time_t expire_at;
+      }; // lru_entry_t
+
+      typedef std::list<lru_entry_t> entriesType;
+      typedef std::map<std::string, entriesType::iterator> indexType;
+      typedef entriesType::size_type entriesSizeType;
+
+      enum lruResultEnum {
+        lruResultMiss			= 0,
+        lruResultPositive		= 1,
+        lruResultNegative		= 2
+      }; // lruResultEnum
+
+      LruCache(const entriesSizeType max_size);
+      virtual ~LruCache();
+
+      // ### Members ###
+      lruResultEnum get(const std::string &key, std::string &value);
+      void put(const std::string &key, const std::string &value, const time_t ttl);
+      void put_negative(const std::string &key, const time_t ttl);
+      void erase(const std::string &key);
+      void clear();
+
+      entriesSizeType size() const { return _entries.size(); }
+      entriesSizeType max_size() const { return _max_size; }
+      unsigned int evicted() const { return _evicted; }
+
+    protected:
+      void insert(const std::string &key, const std::string &value, const bool positive, const time_t ttl);
+
+    private:
+      entriesType _entries;		// most recently used at the front
+      indexType _index;
+      entriesSizeType _max_size;
+      unsigned int _evicted;
+  }; // class LruCache
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -27,6 +27,9 @@
 #define APRSCREATE_MEMCACHEDCONTROLLER_H
 
 #include <set>
+#include <map>
+#include <vector>
+#include <string>
 
 #include <netdb.h>
 #include <unistd.h>
@@ -37,6 +40,7 @@
 #include <arpa/inet.h>
 
 #include <libmemcached/memcached.h>
+#include <libmemcached/util.h>
 #include <openframe/OFLock.h>
 
 namespace aprscreate {
@@ -57,6 +61,21 @@ class MemcachedController_Exception : public openframe::OpenFrame_Exception {
  ** Structures                                                           **
  **************************************************************************/
 
+  // Borrows a connection for the length of one call, the controller's
+  // own when not pooled.
+  class MemcachedController;
+  class MemcachedHandle {
+    public:
+      MemcachedHandle(MemcachedController *controller);
+      ~MemcachedHandle();
+
+      memcached_st *st() { return _st; }
+
+    private:
+      MemcachedController *_controller;
+      memcached_st *_st;
+  }; // MemcachedHandle
+
   class MemcachedController : public openframe::OpenFrame_Abstract {
     public:
       MemcachedController(const std::string &);
@@ -69,8 +88,34 @@ class MemcachedController_Exception : public openframe::OpenFrame_Exception {
         MEMCACHED_CONTROLLER_ERROR
       };
 
+      typedef std::vector<std::string> keysType;
+      typedef std::map<std::string, std::string> valuesType;
+
+      // libmemcached behaviours, timeouts are in ms and 0 leaves the
+      // library default alone
+      struct memcached_opts_t {
+        bool binary;				// binary protocol
+        bool nodelay;				// TCP_NODELAY
+        bool ketama;				// consistent hashing across servers
+        bool noreply;				// fire and forget sets
+        uint64_t connect_timeout;
+        uint64_t poll_timeout;
+        uint64_t failure_limit;			// errors before a server is dropped
+        uint64_t retry_timeout;			// seconds before a dropped server is retried
+      }; // memcached_opts_t
+
+      static void init_opts(memcached_opts_t &opts);
+      MemcachedController &set_opts(const memcached_opts_t &opts);
+      const bool is_noreply() const { return _noreply; }
+      MemcachedController &start_pool(const uint32_t initial, const uint32_t max, const time_t timeout);
+      const bool is_pooled() const { return _pool != NULL; }
+
+      memcached_st *checkout();
+      void checkin(memcached_st *st);
+
       // ### Members ###
       const memcachedReturnEnum get(const std::string &, const std::string &, std::string &);
+      const valuesType::size_type get_multi(const std::string &, const keysType &, valuesType &);
       void put(const std::string &, const std::string &, const std::string &);
       void put(const std::string &, const std::string &, const std::string &, const time_t);
       void replace(const std::string &, const std::string &, const std::string &);
@@ -89,6 +134,11 @@ class MemcachedController_Exception : public openframe::OpenFrame_Exception {
       memcached_st *_st;					// memcached instance
       std::string _memcachedServers;				// server list initialized
       time_t _expire;
+      bool _noreply;
+      memcached_pool_st *_pool;				// shared between threads when set
+      time_t _pool_timeout;				// ms to wait for a free connection
+
+      void behavior(const memcached_behavior_t flag, const uint64_t data);
   }; // MemcachedController
 
 /**************************************************************************
@@ -0,0 +1,172 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_PUBLISHER_H
+#define APRSCREATE_PUBLISHER_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+#include <stomp/Stomp.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Outbound packets on a stomp connection and thread of their own so a
+  // burst from a create pass or a round of decays never sits between the
+  // consumer and its socket.  Sends are buffered and flushed once
+  // flush_size are waiting or the oldest has waited linger ms.
+  //
+  // With a window every send asks for a receipt and up to window sends
+  // are kept in flight, a packet handed over with a token has it show up
+  // in confirmed() once the broker has it.  Anything unconfirmed when the
+  // connection drops or the receipt is too long coming is sent again.
+  class Publisher : public openframe::LogObject {
+    public:
+      // ### Type Definitions ###
+      typedef unsigned long tokenType;		// 0 for don't tell me
+      typedef std::vector<tokenType> tokensType;
+
+      struct publish_t {
+        std::string dest;
+        std::string body;
+        tokenType token;
+        time_t sent_at;
+      }; // publish_t
+
+      typedef std::deque<publish_t> publishesType;
+      typedef publishesType::size_type publishesSizeType;
+      typedef std::map<unsigned long, publish_t> inflightType;	// receipt => send
+
+      struct publisher_stats_t {
+        unsigned int queued;
+        unsigned int sent;
+        unsigned int failed;
+        unsigned int dropped;
+        unsigned int flushes;
+        unsigned int confirmed;
+        unsigned int timeouts;
+        publishesSizeType depth;
+        publishesSizeType inflight;
+      }; // publisher_stats_t
+
+      // ### Constants ### //
+      static const publishesSizeType kDefaultFlushSize;
+      static const publishesSizeType kDefaultMaxQueue;
+      static const int kDefaultLinger;
+      static const int kDefaultRetryWait;
+      static const time_t kDefaultConfirmTimeout;
+
+      Publisher(const openframe::LogObject::thread_id_t thread_id,
+                const std::string &hosts,
+                const std::string &login,
+                const std::string &passcode);
+      virtual ~Publisher();
+
+      // ### Options ### //
+      Publisher &set_flush_size(const publishesSizeType flush_size) {
+        _flush_size = flush_size ? flush_size : 1;
+        return *this;
+      } // set_flush_size
+
+      // ms to hold a partial batch, 0 sends as soon as there's anything
+      Publisher &set_linger(const int linger) {
+        _linger = linger;
+        return *this;
+      } // set_linger
+
+      // sends waiting on a receipt, 0 doesn't ask for receipts
+      Publisher &set_window(const publishesSizeType window) {
+        _window = window;
+        return *this;
+      } // set_window
+
+      // past this publish() drops instead of queueing
+      Publisher &set_max_queue(const publishesSizeType max_queue) {
+        _max_queue = max_queue;
+        return *this;
+      } // set_max_queue
+
+      // ### Members ###
+      void start();
+      void stop();
+      bool publish(const std::string &dest, const std::string &body, const tokenType token=0);
+      size_t confirmed(tokensType &ret);
+      publishesSizeType depth();
+      void stats(publisher_stats_t &ret);
+
+      static void *PublishThread(void *arg);
+
+    protected:
+      bool connect();
+      void loop();
+      void loop_confirmed();
+      publishesSizeType flush(const publishesType &batch);
+      size_t read_receipts();
+      void requeue(publishesType &sends);
+      void wait(const int ms);
+
+    private:
+      pthread_t _thread;
+      pthread_mutex_t _lock;
+      pthread_cond_t _cond;
+
+      std::string _hosts;
+      std::string _login;
+      std::string _passcode;
+      stomp::Stomp *_stomp;
+
+      publishesType _queue;
+      publishesSizeType _flush_size;
+      publishesSizeType _max_queue;
+      publishesSizeType _window;
+      inflightType _inflight;		// publisher thread only
+      unsigned long _next_receipt;
+      tokensType _confirmed;
+      int _linger;
+      bool _started;
+      bool _done;
+
+      publisher_stats_t _stats;
+  }; // class Publisher
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -0,0 +1,93 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#ifndef APRSCREATE_SINGLEFLIGHT_H
+#define APRSCREATE_SINGLEFLIGHT_H
+
+#include <string>
+#include <map>
+
+#include <pthread.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Coalesces concurrent lookups of the same key across threads.  The
+  // first caller in becomes the leader and does the real work, anyone
+  // asking for the same key meanwhile waits on it and shares the answer.
+  //
+  //   SingleFlight::flight_t *flight;
+  //   if (flights->join(key, flight)) {
+  //     ... lookup ...
+  //     flights->finish(flight, value, ok);
+  //   } // if
+  //   else ok = flights->wait(flight, value, timeout);
+  //
+  // The leader has to finish() on every way out, a waiter gives up after
+  // timeout seconds and gets false the same as a failed lookup.
+  class SingleFlight {
+    public:
+      // ### Type Definitions ###
+      struct flight_t {
+        std::string key;
+        std::string value;
+        bool ok;
+        bool done;
+        unsigned int refs;
+      }; // flight_t
+
+      typedef std::map<std::string, flight_t *> flightsType;
+
+      SingleFlight();
+      virtual ~SingleFlight();
+
+      // ### Members ###
+      bool join(const std::string &key, flight_t *&flight);
+      void finish(flight_t *flight, const std::string &value, const bool ok);
+      bool wait(flight_t *flight, std::string &value, const double timeout);
+
+    protected:
+      void release(flight_t *flight);
+
+    private:
+      pthread_mutex_t _lock;
+      pthread_cond_t _done_cond;
+      flightsType _flights;
+  }; // class SingleFlight
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -0,0 +1,120 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_SPSCRING_H
+#define APRSCREATE_SPSCRING_H
+
+#include <cstddef>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Bounded ring for handing values from exactly one producer thread to
+  // exactly one consumer thread without a lock.  The producer only ever
+  // moves the tail and the consumer only the head, so each index has a
+  // single writer and acquire/release ordering on them is enough.
+  template<typename T>
+  class SpscRing {
+    public:
+      // capacity is rounded up to a power of two
+      explicit SpscRing(const size_t capacity) : _head(0), _tail(0) {
+        size_t size = 1;
+        while(size < capacity) size <<= 1;
+
+        _mask = size - 1;
+        _buf = new T[size];
+      } // SpscRing
+
+      virtual ~SpscRing() {
+        delete [] _buf;
+      } // ~SpscRing
+
+      // ### Producer ### //
+      bool push(const T &value) {
+        size_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        size_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+        if (tail - head > _mask) return false;
+
+        _buf[tail & _mask] = value;
+        __atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+      } // push
+
+      // ### Consumer ### //
+      bool pop(T &value) {
+        size_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        size_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) return false;
+
+        value = _buf[head & _mask];
+        __atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+      } // pop
+
+      // look at what pop() would hand out without taking it
+      bool peek(T &value) const {
+        size_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        size_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) return false;
+
+        value = _buf[head & _mask];
+        return true;
+      } // peek
+
+      // only a snapshot when called from the other side
+      size_t size() const {
+        return __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+      } // size
+
+      bool empty() const { return size() == 0; }
+      size_t capacity() const { return _mask + 1; }
+
+    private:
+      SpscRing(const SpscRing &);
+      SpscRing &operator=(const SpscRing &);
+
+      T *_buf;
+      size_t _mask;
+      // keep the two sides off each other's cache line
+      char _pad0[64];
+      size_t _head;
+      char _pad1[64];
+      size_t _tail;
+      char _pad2[64];
+  }; // class SpscRing
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
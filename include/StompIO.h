@@ -0,0 +1,179 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_STOMPIO_H
+#define APRSCREATE_STOMPIO_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+#include <stomp/Stomp.h>
+#include <stomp/StompFrame.h>
+
+#include "SpscRing.h"
+#include "Brokers.h"
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Runs a worker's stomp connection on a thread of its own so the socket
+  // keeps getting read, and heart-beats answered, while the worker is stuck
+  // in a slow query.  Frames come in over one ring and acks and sends go
+  // back over another, the worker never touches the connection itself.
+  //
+  // Every connection gets a new generation and frames are handed out with
+  // the one they were read on.  Acks carry it back and are dropped when
+  // the connection they were for is gone, the broker redelivers those
+  // frames anyway.  Sends that fail are kept and go out on the next
+  // connection, a send handed over with a token has it show up in sent()
+  // once it is on the wire.
+  class StompIO : public openframe::LogObject {
+    public:
+      // ### Type Definitions ###
+      enum opTypeEnum {
+        opTypeAck		= 0,
+        opTypeSend		= 1
+      }; // opTypeEnum
+
+      typedef unsigned long tokenType;		// 0 for don't tell me
+      typedef std::vector<tokenType> tokensType;
+
+      struct stomp_op_t {
+        opTypeEnum type;
+        std::string dest;	// subscription for acks
+        std::string body;	// message-id for acks
+        unsigned int generation;	// connection an ack is for
+        tokenType token;
+      }; // stomp_op_t
+
+      struct io_frame_t {
+        stomp::StompFrame *frame;
+        unsigned int generation;
+      }; // io_frame_t
+
+      typedef SpscRing<io_frame_t> framesRingType;
+      typedef SpscRing<stomp_op_t *> opsRingType;
+      typedef std::deque<stomp_op_t *> opsType;
+      typedef std::vector<std::pair<std::string, std::string> > subscriptionsType;
+
+      // ### Constants ### //
+      static const size_t kDefaultRingSize;
+      static const size_t kDefaultReadBurst;
+      static const int kDefaultIdleWait;
+      static const int kDefaultReconnectWait;
+
+      // the connection is borrowed and has to outlive us
+      StompIO(const openframe::LogObject::thread_id_t thread_id,
+              stomp::Stomp *stomp,
+              const size_t ring_size=kDefaultRingSize);
+      virtual ~StompIO();
+
+      // process wide, not owned; reconnects back off with its jitter and
+      // report to it
+      StompIO &set_brokers(Brokers *brokers) {
+        _brokers = brokers;
+        return *this;
+      } // set_brokers
+
+      // ### Members ###
+      StompIO &subscribe(const std::string &dest, const std::string &id);
+      void start();
+      void stop();
+
+      // worker side
+      bool next_frame(stomp::StompFrame *&frame, unsigned int &generation);
+      bool next_generation(unsigned int &generation) const;
+      bool ack(const std::string &message_id, const std::string &subscription, const unsigned int generation);
+      bool send(const std::string &dest, const std::string &body, const tokenType token=0);
+      size_t sent(tokensType &ret);
+      void drain_ready();
+
+      bool is_connected() const { return __atomic_load_n(&_connected, __ATOMIC_ACQUIRE); }
+      const std::string connected_to();
+      // readable while frames are waiting
+      int ready_fd() const { return _ready_fd; }
+
+      static void *IOThread(void *arg);
+
+    protected:
+      void loop();
+      bool connect();
+      bool run();
+      bool push_frame(stomp::StompFrame *frame);
+      bool push_op(stomp_op_t *op);
+      size_t flush_ops();
+      bool run_op(stomp_op_t *op);
+      void wait(const int ms);
+      int backoff();
+      void ready();
+
+    private:
+      pthread_t _thread;
+      pthread_mutex_t _lock;		// guards _connected_to and _sent
+      stomp::Stomp *_stomp;
+      Brokers *_brokers;
+      unsigned int _attempts;		// failed connects since the last good one
+      unsigned int _seed;
+      framesRingType _frames;
+      opsRingType _ops;
+      opsType _retry;			// failed sends, I/O thread only
+      tokensType _sent;
+      subscriptionsType _subscriptions;
+      stomp::StompFrame *_held;		// read while _frames was full
+      unsigned int _generation;		// bumped on every connect
+      std::string _connected_to;
+      int _ready_fd;
+      bool _connected;
+      bool _started;
+      bool _done;
+
+      struct io_stats_t {
+        unsigned int connects;
+        unsigned int disconnects;
+        unsigned int held;
+        unsigned int ops_waited;
+        unsigned int retried;
+        unsigned int stale_acks;
+      } _stats;
+  }; // class StompIO
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -30,6 +30,10 @@
 #include <openstats/StatsClient_Interface.h>
 
 #include "DBI.h"
+#include "StoreBackend.h"
+#include "LruCache.h"
+#include "CircuitBreaker.h"
+#include "MemcachedController.h"
 
 namespace aprscreate {
 
@@ -40,20 +44,35 @@ namespace aprscreate {
 /**************************************************************************
  ** Structures                                                           **
  **************************************************************************/
-  class MemcachedController;
+  class ConcurrentCache;
+  class SingleFlight;
   class Store : public openframe::LogObject,
                  public openstats::StatsClient_Interface {
     public:
       static const time_t kDefaultReportInterval;
+      static const double kDefaultDeadline;
+      static const time_t kDefaultDeadlineBackoff;
+      static const size_t kDefaultL1Size;
+      static const time_t kDefaultL1Ttl;
+      static const time_t kDefaultL1NegativeTtl;
+      static const time_t kDefaultAckNegativeTtl;
+      static const unsigned int kDefaultRefreshFraction;
+      static const size_t kDefaultSessionBatchMin;
 
       enum verifyStatusEnum {
         verifyStatusFail		= 0,
         verifyStatusSuccess		= 1,
         verifyStatusAlreadyVerified	= 2,
         verifyStatusIgnoredResend	= 3,
-        verifyStatusInvalidArgs		= 4
+        verifyStatusInvalidArgs		= 4,
+        verifyStatusTimeout		= 5
       }; // verifyEnum
 
+      enum storeStatusEnum {
+        storeStatusOk			= 0,
+        storeStatusTimeout		= 1
+      }; // storeStatusEnum
+
       Store(const openframe::LogObject::thread_id_t thread_id,
             const std::string &host,
             const std::string &user,
@@ -69,27 +88,113 @@ namespace aprscreate {
 
       void try_stats();
 
+      // shared backend, not owned; leave unset to use MySQL
+      Store &set_backend(StoreBackend *backend) {
+        _backend = backend;
+        return *this;
+      } // set_backend
+
+      // process wide cache, not owned; holds acks when there's no memcached
+      Store &set_shared_cache(ConcurrentCache *shared) {
+        _shared = shared;
+        return *this;
+      } // set_shared_cache
+
+      // process wide, not owned; coalesces concurrent session lookups
+      Store &set_single_flight(SingleFlight *flights) {
+        _flights = flights;
+        return *this;
+      } // set_single_flight
+
+      // shared controller, not owned; used instead of creating our own
+      Store &set_memcached(MemcachedController *memcached) {
+        _memcached_shared = memcached;
+        return *this;
+      } // set_memcached
+
+      // skip rewriting an ack key with the same value until this percent
+      // of its ttl has passed, 0 writes every time
+      Store &set_refresh_fraction(const unsigned int refresh_fraction) {
+        _refresh_fraction = refresh_fraction;
+        return *this;
+      } // set_refresh_fraction
+
+      Store &set_memcached_opts(const MemcachedController::memcached_opts_t &opts) {
+        _memcached_opts = opts;
+        return *this;
+      } // set_memcached_opts
+
+      Store &set_breaker_opts(const CircuitBreaker::breaker_opts_t &opts) {
+        _breaker_opts = opts;
+        return *this;
+      } // set_breaker_opts
+
+      // per call budget in seconds, set as the MySQL connect, read and
+      // write timeouts; a call that times out fails every call fast for
+      // the backoff interval after
+      Store &set_deadline(const double deadline) {
+        _deadline.budget = deadline;
+        return *this;
+      } // set_deadline
+
+      Store &set_deadline_backoff(const time_t backoff) {
+        _deadline.backoff = backoff;
+        return *this;
+      } // set_deadline_backoff
+
+      // in process cache in front of memcached and the session lookup,
+      // a size of 0 turns it off
+      Store &set_l1_size(const size_t l1_size) {
+        _l1_opts.size = l1_size;
+        return *this;
+      } // set_l1_size
+
+      Store &set_l1_ttl(const time_t l1_ttl) {
+        _l1_opts.ttl = l1_ttl;
+        return *this;
+      } // set_l1_ttl
+
+      Store &set_l1_negative_ttl(const time_t l1_negative_ttl) {
+        _l1_opts.negative_ttl = l1_negative_ttl;
+        return *this;
+      } // set_l1_negative_ttl
+
+      // log any query slower than this many seconds
+      Store &set_slow_query(const double slow_query) {
+        _slow_query = slow_query;
+        return *this;
+      } // set_slow_query
+
+      storeStatusEnum last_status() const { return _last_status; }
+      bool is_timeout() const { return _last_status == storeStatusTimeout; }
+      bool is_stalled() const { return _deadline.stalled_until > time(NULL); }
+
       verifyStatusEnum tryVerify(const std::string &id, const std::string &callsign, const std::string &key);
 
       bool getAckFromMemcached(const std::string &target, std::string &ret);
       bool setAckInMemcached(const std::string &target, const std::string &buf, const time_t expire);
+      size_t getAcksFromMemcached(const MemcachedController::keysType &targets);
+      bool isAckCached(const std::string &target);
 
       bool isUserSession(const std::string &callsign, const time_t start_ts);
+      size_t resolveSessions(const std::vector<std::string> &callsigns, const time_t start_ts);
+      size_t preloadSessions(const time_t start_ts, const time_t ttl);
+      void pushSession(const std::string &callsign, const bool active, const time_t ttl);
       openframe::DBI::resultSizeType getLastMessageId(const std::string &source, std::string &id);
       openframe::DBI::resultSizeType getMessageDecayId(const std::string &source,
                                                        const std::string &target,
                                                        const std::string &msgack, std::string &id);
       openframe::DBI::resultSizeType getObjectDecayId(const std::string &name, const time_t start_ts,
                                                       std::string &id);
-      openframe::DBI::resultSizeType getPendingMessages(openframe::DBI::resultType &res);
+      openframe::DBI::resultSizeType getPendingMessages(StoreResult &res);
       openframe::DBI::simpleResultSizeType setMessageAck(const std::string &source, const std::string &target,
                                                          const std::string &msgack);
       openframe::DBI::simpleResultSizeType setMessageSent(const int id, const std::string &decay_id, const time_t broadcast_ts);
       openframe::DBI::simpleResultSizeType setMessageError(const int id);
-      openframe::DBI::resultSizeType getPendingObjects(const time_t now, openframe::DBI::resultType &res);
+      openframe::DBI::resultSizeType getPendingObjects(const time_t now, StoreResult &res);
       openframe::DBI::simpleResultSizeType setObjectSent(const int id, const std::string &decay_id, const time_t broadcast_ts);
       openframe::DBI::simpleResultSizeType setObjectError(const int id);
-      openframe::DBI::resultSizeType getPendingPositions(openframe::DBI::resultType &res);
+      openframe::DBI::resultSizeType getPendingPositions(StoreResult &res);
       openframe::DBI::simpleResultSizeType setPositionSent(const int id, const time_t broadcast_ts);
       openframe::DBI::simpleResultSizeType setPositionError(const int id);
 
@@ -97,11 +202,30 @@ namespace aprscreate {
 
     protected:
       void try_stompstats();
-      bool isMemcachedOk() const { return _last_cache_fail_at < time(NULL) - 60; }
+      bool allow_memcached();
+
+      void written(const std::string &key, const std::string &buf, const time_t expire);
+      bool is_written(const std::string &key, const std::string &buf);
+      LruCache::lruResultEnum l1_get(const std::string &key, std::string &ret);
+
+      bool begin_call();
+      void end_call(const char *name);
+
+      void describe_query_stats();
+      void try_query_stats();
+      void report_query_stats();
 
     private:
       DBI *_dbi;			// new Injection handler
+      StoreBackend *_backend;		// where calls go, _dbi or shared
       MemcachedController *_memcached;	// memcached controller instance
+      MemcachedController *_memcached_shared;	// pooled controller from App
+      LruCache *_l1;			// per worker cache in front of everything
+      LruCache *_written;		// recent ack writes still fresh upstream, no shared cache
+      unsigned int _refresh_fraction;
+      ConcurrentCache *_shared;		// shared by all workers, App owns it
+      SingleFlight *_flights;		// in flight lookups, App owns it
+      CircuitBreaker *_breaker;		// guards memcached
       openframe::Stopwatch *_profile;
 
       // contructor vars
@@ -111,13 +235,32 @@ namespace aprscreate {
       std::string _db;
       std::string _memcached_host;
       time_t _expire_interval;
-      time_t _last_cache_fail_at;
+      CircuitBreaker::breaker_opts_t _breaker_opts;
+      MemcachedController::memcached_opts_t _memcached_opts;
+      unsigned int _breaker_trips;	// trips as of the last stomp report
+      storeStatusEnum _last_status;
+      double _slow_query;
+      DBI::queryStatsType _query_report;
+
+      struct l1_opts_t {
+        size_t size;
+        time_t ttl;
+        time_t negative_ttl;
+      } _l1_opts;
+
+      struct deadline_t {
+        double budget;
+        time_t backoff;
+        time_t stalled_until;
+        openframe::Stopwatch sw;
+      } _deadline;
 
     struct memcache_stats_t {
       unsigned int hits;
       unsigned int misses;
       unsigned int tries;
       unsigned int stored;
+      unsigned int coalesced;
     }; // memcache_stats_t
 
     struct sql_stats_t {
@@ -128,11 +271,47 @@ namespace aprscreate {
       unsigned int failed;
     };
 
+    struct mget_stats_t {
+      unsigned int calls;
+      unsigned int keys;
+      unsigned int found;
+    }; // mget_stats_t
+
+    struct l1_stats_t {
+      unsigned int hits;
+      unsigned int negative;
+      unsigned int misses;
+      unsigned int tries;
+    }; // l1_stats_t
+
+    struct session_stats_t {
+      unsigned int started;
+      unsigned int ended;
+      unsigned int preloaded;
+      unsigned int batches;
+      unsigned int batched;
+    }; // session_stats_t
+
+    struct breaker_stats_t {
+      unsigned int rejected;
+    }; // breaker_stats_t
+
+    struct deadline_stats_t {
+      unsigned int timeouts;
+      unsigned int failfast;
+    }; // deadline_stats_t
+
     struct obj_stats_t {
       memcache_stats_t cache_ack;
       memcache_stats_t cache_session;
+      l1_stats_t cache_l1;
+      mget_stats_t cache_mget;
       sql_stats_t sql_ack;
       sql_stats_t sql_session;
+      session_stats_t push_session;
+      deadline_stats_t deadline;
+      breaker_stats_t breaker;
+      unsigned int coalesced;
       time_t last_report_at;
       time_t report_interval;
       time_t created_at;
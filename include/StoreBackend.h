@@ -0,0 +1,146 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_STOREBACKEND_H
+#define APRSCREATE_STOREBACKEND_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <openframe/DBI.h>
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  // Backend neutral result rows, field access mirrors what mysql++ rows
+  // give us so row decoding reads the same whatever the backend.
+  class StoreField {
+    public:
+      StoreField() : _null(true) { };
+      StoreField(const std::string &value) : _value(value), _null(false) { };
+
+      const char *c_str() const { return _value.c_str(); }
+      bool is_null() const { return _null; }
+      void to_string(std::string &ret) const { ret = _value; }
+      bool operator==(const char *value) const { return !_null && _value == value; }
+
+    private:
+      std::string _value;
+      bool _null;
+  }; // class StoreField
+
+  class StoreResult;
+  class StoreRow {
+    public:
+      typedef std::vector<StoreField> fieldsType;
+
+      StoreRow(const StoreResult *result) : _result(result) { };
+
+      const StoreField &operator[](const char *name) const;
+      void push(const StoreField &field) { _fields.push_back(field); }
+
+    private:
+      const StoreResult *_result;
+      fieldsType _fields;
+  }; // class StoreRow
+
+  class StoreResult : public std::vector<StoreRow> {
+    public:
+      typedef std::map<std::string, size_type> columnsType;
+
+      StoreResult() { };
+
+      size_type num_rows() const { return size(); }
+      void add_column(const std::string &name);
+      bool find_column(const std::string &name, size_type &i) const;
+      StoreRow &add_row();
+      void reset();
+
+    private:
+      // rows point back here for the column index
+      StoreResult(const StoreResult &);
+      StoreResult &operator=(const StoreResult &);
+
+      columnsType _columns;
+  }; // class StoreResult
+
+  // Everything Store needs from whatever keeps the pending, sent, ack,
+  // session and verify state.  DBI is the MySQL implementation.
+  class StoreBackend {
+    public:
+      StoreBackend() { };
+      virtual ~StoreBackend() { };
+
+      virtual bool isUserVerified(const std::string &callsign) = 0;
+      virtual bool getUserMsgChecksum(const std::string &id, const std::string &callsign, const std::string &key) = 0;
+      virtual openframe::DBI::simpleResultSizeType setUserMsgChecksum(const std::string &id,
+                                                                     const std::string &callsign,
+                                                                     const std::string &key) = 0;
+      virtual openframe::DBI::simpleResultSizeType setTryUserVerify(const std::string &id,
+                                                                   const std::string &callsign,
+                                                                   const std::string &key) = 0;
+
+      virtual bool isUserSession(const std::string &callsign, const time_t start_ts) = 0;
+      virtual openframe::DBI::resultSizeType getActiveSessions(const time_t start_ts, StoreResult &res) = 0;
+      // which of callsigns are logged in, one callsign column per row
+      virtual openframe::DBI::resultSizeType getSessionsFor(const std::vector<std::string> &callsigns,
+                                                            const time_t start_ts,
+                                                            StoreResult &res) = 0;
+      virtual openframe::DBI::resultSizeType getLastMessageId(const std::string &source, std::string &id) = 0;
+      virtual openframe::DBI::resultSizeType getMessageDecayId(const std::string &source, const std::string &target,
+                                                               const std::string &msgack, std::string &id) = 0;
+      virtual openframe::DBI::resultSizeType getObjectDecayId(const std::string &name, const time_t start_ts,
+                                                              std::string &id) = 0;
+      virtual openframe::DBI::resultSizeType getPendingMessages(StoreResult &res) = 0;
+      virtual openframe::DBI::simpleResultSizeType setMessageAck(const std::string &source, const std::string &target,
+                                                                 const std::string &msgack) = 0;
+      virtual openframe::DBI::simpleResultSizeType setMessageSent(const int id, const std::string &decay_id,
+                                                                  const time_t broadcast_ts) = 0;
+      virtual openframe::DBI::simpleResultSizeType setMessageError(const int id) = 0;
+      virtual openframe::DBI::resultSizeType getPendingObjects(const time_t now, StoreResult &res) = 0;
+      virtual openframe::DBI::simpleResultSizeType setObjectSent(const int id, const std::string &decay_id,
+                                                                 const time_t broadcast_ts) = 0;
+      virtual openframe::DBI::simpleResultSizeType setObjectError(const int id) = 0;
+      virtual openframe::DBI::resultSizeType getPendingPositions(StoreResult &res) = 0;
+      virtual openframe::DBI::simpleResultSizeType setPositionSent(const int id, const time_t broadcast_ts) = 0;
+      virtual openframe::DBI::simpleResultSizeType setPositionError(const int id) = 0;
+  }; // class StoreBackend
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+
+} // namespace aprscreate
+#endif
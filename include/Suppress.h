@@ -0,0 +1,129 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Daniel Robert Karrels                             **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#ifndef APRSCREATE_SUPPRESS_H
+#define APRSCREATE_SUPPRESS_H
+
+#include <string>
+#include <map>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+
+namespace aprscreate {
+/**************************************************************************
+ ** General Defines                                                      **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Structures                                                           **
+ **************************************************************************/
+
+  class SuppressMe {
+    public:
+      SuppressMe() { };
+      virtual ~SuppressMe() { };
+
+      std::string source;
+      std::string status;
+      char symbol_table;
+      char symbol_code;
+      double latitude;
+      double longitude;
+      double speed;
+      int course;
+      time_t broadcast_ts;
+  }; // class SuppressMe
+
+  // Shared by every worker, each call takes the lock on its own so two
+  // workers with the same station at once may both send it.
+  class Suppress : public openframe::LogObject {
+    public:
+      // ### Type Definitions ###
+      typedef std::map<std::string, SuppressMe *> suppressMapType;
+      typedef suppressMapType::size_type suppressMapSizeType;
+
+      // ### Constants ### //
+      static const double kDefaultDistance;
+      static const int kDefaultCourse;
+      static const double kDefaultSpeed;
+      static const time_t kDefaultInterval;
+
+      Suppress(const openframe::LogObject::thread_id_t thread_id=0);	// constructor
+      virtual ~Suppress();				// destructor
+
+      // ### Options ### //
+      Suppress &set_distance(const double distance) {
+        _distance = distance;
+        return *this;
+      } // set_distance
+
+      Suppress &set_course(const int course) {
+        _course = course;
+        return *this;
+      } // set_course
+
+      Suppress &set_speed(const double speed) {
+        _speed = speed;
+        return *this;
+      } // set_speed
+
+      Suppress &set_interval(const time_t interval) {
+        _interval = interval;
+        return *this;
+      } // set_interval
+
+      // ### Members ###
+      const bool is_suppressed(const SuppressMe &);
+      void update(const SuppressMe &);
+      const suppressMapSizeType expire();
+      const suppressMapSizeType size();
+      const suppressMapSizeType clear();
+
+      static const double distance(const double, const double, const double, const double);
+
+      /***************
+       ** Variables **
+       ***************/
+    public:
+    protected:
+    private:
+      pthread_mutex_t _lock;
+      suppressMapType _suppressMap;
+
+      double _distance;		// meters
+      int _course;			// degrees
+      double _speed;
+      time_t _interval;		// max silence
+  }; // class Suppress
+
+/**************************************************************************
+ ** Macro's                                                              **
+ **************************************************************************/
+
+/**************************************************************************
+ ** Proto types                                                          **
+ **************************************************************************/
+} // namespace aprscreate
+#endif
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
 #include <list>
 
 #include <openframe/openframe.h>
@@ -10,6 +12,13 @@
 #include <stomp/Stomp.h>
 #include <aprs/APRS.h>
 
+#include "CircuitBreaker.h"
+#include "MemcachedController.h"
+#include "StompIO.h"
+#include "Dispatcher.h"
+#include "Publisher.h"
+#include "Brokers.h"
+
 namespace aprscreate {
 /**************************************************************************
  ** General Defines                                                      **
@@ -21,6 +30,11 @@ namespace aprscreate {
 
   class Store;
   class Decay;
+  class Suppress;
+  class JobPool;
+  class StoreBackend;
+  class ConcurrentCache;
+  class SingleFlight;
   class Worker_Exception : public openframe::OpenFrame_Exception {
     public:
       Worker_Exception(const std::string message) throw() : openframe::OpenFrame_Exception(message) { };
@@ -36,11 +50,24 @@ namespace aprscreate {
       static const char *kDefaultStompDestFeedsAprsIs;
       static const char *kDefaultStompDestPushAprs;
       static const char *kDefaultStompDestNotifyMessages;
+      static const char *kDefaultStompDestNotifySessions;
       static const char *kDefaultAprsDest;
       static const char *kDefaultDigiList;
       static const time_t kDefaultDecayRetry;
       static const time_t kDefaultDecayTimeout;
       static const time_t kDefaultSessionExpire;
+      static const time_t kDefaultSessionPushTtl;
+      static const size_t kDefaultCreateThreshold;
+      static const size_t kDefaultBatchSize;
+      static const int kDefaultIdleMin;
+      static const int kDefaultIdleMax;
+      static const int kDefaultReconnectWait;
+      static const double kDefaultFlowTarget;
+      static const char *kDefaultLagHeader;
+      static const double kDefaultLagWarn;
+      static const time_t kDefaultLagWarnInterval;
+      static const unsigned int kNumLagBuckets = 13;
+      static const double kLagBuckets[kNumLagBuckets];
 
       // ### Init ### //
       Worker(const openframe::LogObject::thread_id_t thread_id,
@@ -55,9 +82,45 @@ namespace aprscreate {
       virtual ~Worker();
       void init();
       bool run();
+      void idle(const int wake_fd);
       void try_stats();
 
       // ### Type Definitions ###
+      typedef std::vector<stomp::StompFrame *> framesType;
+      // subscription => last message-id seen on it
+      typedef std::map<std::string, std::string> ackIdsType;
+
+      struct staged_frame_t {
+        stomp::StompFrame *frame;	// NULL when handed over by the dispatcher
+        std::string body;
+        std::string source;
+        std::string target;
+        bool is_message;
+      }; // staged_frame_t
+
+      typedef std::vector<staged_frame_t> stagedType;
+
+      enum sentTypeEnum {
+        sentTypeMessage		= 0,
+        sentTypeObject		= 1,
+        sentTypePosition	= 2
+      }; // sentTypeEnum
+
+      enum pushResultEnum {
+        pushResultSent		= 0,	// mark it sent now
+        pushResultQueued	= 1,	// marked once it's confirmed
+        pushResultDropped	= 2	// never went out, leave it pending
+      }; // pushResultEnum
+
+      struct unconfirmed_t {
+        sentTypeEnum type;
+        int id;
+        std::string decay_id;
+        time_t sent_at;
+      }; // unconfirmed_t
+
+      typedef std::map<Publisher::tokenType, unconfirmed_t> unconfirmedType;
+      typedef std::map<std::pair<int, int>, Publisher::tokenType> unconfirmedRowsType;
 
       // ### Options ### //
       Worker &set_console(const bool onoff) {
@@ -88,7 +151,250 @@ namespace aprscreate {
         return *this;
       } // set_console
 
-      bool push_aprs(const std::string &body);
+      // where message notifications are read from, point it at a queue to
+      // have the broker split them between workers
+      Worker &set_stomp_dest_notify_messages(const std::string &dest) {
+        _stomp_dest_notify_msgs = dest;
+        return *this;
+      } // set_stomp_dest_notify_messages
+
+      // fan out mode, only the reader subscribes to the messages and hands
+      // them to every worker's shard, App owns the dispatcher
+      Worker &set_dispatcher(Dispatcher *dispatcher, const unsigned int shard, const bool reader) {
+        _dispatcher = dispatcher;
+        _dispatch_shard = shard;
+        _dispatch_reader = reader;
+        return *this;
+      } // set_dispatcher
+
+      // topic the web tier announces session start/end on, "" for none
+      Worker &set_stomp_dest_notify_sessions(const std::string &dest) {
+        _stomp_dest_notify_sessions = dest;
+        return *this;
+      } // set_stomp_dest_notify_sessions
+
+      Worker &set_session_push_ttl(const time_t session_push_ttl) {
+        _session_push_ttl = session_push_ttl;
+        return *this;
+      } // set_session_push_ttl
+
+      // seconds behind the producer's timestamp a frame can finish before
+      // we warn about it, 0 never warns
+      Worker &set_lag_warn(const double lag_warn) {
+        _lag.warn = lag_warn;
+        return *this;
+      } // set_lag_warn
+
+      // ms to wait when run() found nothing, doubles up to the max while
+      // the worker stays idle
+      Worker &set_idle_min(const int idle_min) {
+        _idle.min = idle_min > 0 ? idle_min : 1;
+        return *this;
+      } // set_idle_min
+
+      Worker &set_idle_max(const int idle_max) {
+        _idle.max = idle_max;
+        return *this;
+      } // set_idle_max
+
+      // hand the stomp connection to a thread of its own so slow queries
+      // don't hold up reading the socket
+      Worker &set_stomp_io(const bool stomp_io) {
+        _stomp_io = stomp_io;
+        return *this;
+      } // set_stomp_io
+
+      Worker &set_stomp_io_ring(const size_t stomp_io_ring) {
+        _stomp_io_ring = stomp_io_ring;
+        return *this;
+      } // set_stomp_io_ring
+
+      // process wide, not owned; picks the host to connect to and how long
+      // to wait between tries, leave unset to use the host list as given
+      Worker &set_brokers(Brokers *brokers) {
+        _brokers = brokers;
+        return *this;
+      } // set_brokers
+
+      // keep a connection open to the next best broker to switch to when
+      // ours drops, needs brokers and isn't used with the I/O thread
+      Worker &set_stomp_standby(const bool stomp_standby) {
+        _stomp_standby = stomp_standby;
+        return *this;
+      } // set_stomp_standby
+
+      // outbound packets on their own connection and thread instead of
+      // the one we consume on
+      Worker &set_publish(const bool publish) {
+        _publish_opts.enabled = publish;
+        return *this;
+      } // set_publish
+
+      Worker &set_publish_flush_size(const size_t flush_size) {
+        _publish_opts.flush_size = flush_size;
+        return *this;
+      } // set_publish_flush_size
+
+      Worker &set_publish_linger(const int linger) {
+        _publish_opts.linger = linger;
+        return *this;
+      } // set_publish_linger
+
+      // packets waiting on a broker receipt, rows are only marked sent once
+      // theirs comes back, 0 marks them sent as soon as they're queued
+      Worker &set_publish_window(const size_t window) {
+        _publish_opts.window = window;
+        return *this;
+      } // set_publish_window
+
+      Worker &set_publish_max_queue(const size_t max_queue) {
+        _publish_opts.max_queue = max_queue;
+        return *this;
+      } // set_publish_max_queue
+
+      // frames the broker may have out to us unacked, only read when
+      // subscribing, so it is also the most a paused reader holds
+      Worker &set_stomp_prefetch(const int stomp_prefetch) {
+        _stomp_prefetch = stomp_prefetch;
+        return *this;
+      } // set_stomp_prefetch
+
+      // seconds a batch should take, the window shrinks when they run
+      // over and grows back while they don't, 0 always drains a full batch;
+      // only how many we take per batch, not what the broker sends us
+      Worker &set_flow_target(const double flow_target) {
+        _flow.target = flow_target;
+        return *this;
+      } // set_flow_target
+
+      // fan out reader holds on to message frames unacked once this many
+      // messages are waiting on the workers, and hands them on again when
+      // they're down to resume
+      Worker &set_flow_pause(const size_t pause, const size_t resume) {
+        _flow.pause = pause;
+        _flow.resume = resume;
+        return *this;
+      } // set_flow_pause
+
+      // frames drained per run(), stats and timers are checked once per batch
+      Worker &set_batch_size(const size_t batch_size) {
+        _batch_size = batch_size ? batch_size : 1;
+        _flow.window = _batch_size;
+        return *this;
+      } // set_batch_size
+
+      // ack only the last frame of a batch per subscription, the
+      // subscription has to be in ack:client mode for this to be safe
+      Worker &set_batch_ack_cumulative(const bool batch_ack_cumulative) {
+        _batch_ack_cumulative = batch_ack_cumulative;
+        return *this;
+      } // set_batch_ack_cumulative
+
+      Worker &set_create_threads(const unsigned int create_threads) {
+        _create_threads = create_threads;
+        return *this;
+      } // set_create_threads
+
+      Worker &set_create_threshold(const size_t create_threshold) {
+        _create_threshold = create_threshold;
+        return *this;
+      } // set_create_threshold
+
+      // shared with every other worker, App owns it
+      Worker &set_store_backend(StoreBackend *store_backend) {
+        _store_backend = store_backend;
+        return *this;
+      } // set_store_backend
+
+      Worker &set_shared_cache(ConcurrentCache *shared_cache) {
+        _shared_cache = shared_cache;
+        return *this;
+      } // set_shared_cache
+
+      Worker &set_single_flight(SingleFlight *single_flight) {
+        _single_flight = single_flight;
+        return *this;
+      } // set_single_flight
+
+      Worker &set_sql_deadline(const double sql_deadline) {
+        _sql_deadline = sql_deadline;
+        return *this;
+      } // set_sql_deadline
+
+      Worker &set_sql_deadline_backoff(const time_t sql_deadline_backoff) {
+        _sql_deadline_backoff = sql_deadline_backoff;
+        return *this;
+      } // set_sql_deadline_backoff
+
+      Worker &set_sql_slow_query(const double sql_slow_query) {
+        _sql_slow_query = sql_slow_query;
+        return *this;
+      } // set_sql_slow_query
+
+      Worker &set_l1_size(const size_t l1_size) {
+        _l1_size = l1_size;
+        return *this;
+      } // set_l1_size
+
+      Worker &set_l1_ttl(const time_t l1_ttl) {
+        _l1_ttl = l1_ttl;
+        return *this;
+      } // set_l1_ttl
+
+      Worker &set_l1_negative_ttl(const time_t l1_negative_ttl) {
+        _l1_negative_ttl = l1_negative_ttl;
+        return *this;
+      } // set_l1_negative_ttl
+
+      // one for every worker, any of them may pick up a station's next
+      // position so the last broadcast has to be seen by all of them
+      Worker &set_suppress(Suppress *suppress) {
+        _suppress = suppress;
+        return *this;
+      } // set_suppress
+
+      Worker &set_breaker_error_rate(const double error_rate) {
+        _breaker_opts.error_rate = error_rate;
+        return *this;
+      } // set_breaker_error_rate
+
+      Worker &set_breaker_slow(const double slow) {
+        _breaker_opts.slow = slow;
+        return *this;
+      } // set_breaker_slow
+
+      Worker &set_breaker_backoff(const double backoff) {
+        _breaker_opts.backoff = backoff;
+        return *this;
+      } // set_breaker_backoff
+
+      Worker &set_breaker_backoff_max(const double backoff_max) {
+        _breaker_opts.backoff_max = backoff_max;
+        return *this;
+      } // set_breaker_backoff_max
+
+      Worker &set_breaker_trials(const unsigned int trials) {
+        _breaker_opts.trials = trials;
+        return *this;
+      } // set_breaker_trials
+
+      Worker &set_memcached_refresh(const unsigned int memcached_refresh) {
+        _memcached_refresh = memcached_refresh;
+        return *this;
+      } // set_memcached_refresh
+
+      Worker &set_memcached_opts(const MemcachedController::memcached_opts_t &opts) {
+        _memcached_opts = opts;
+        return *this;
+      } // set_memcached_opts
+
+      // process wide pooled controller, not owned; replaces our own
+      Worker &set_memcached_pool(MemcachedController *memcached_pool) {
+        _memcached_pool = memcached_pool;
+        return *this;
+      } // set_memcached_pool
+
+      bool push_aprs(const std::string &body, const Publisher::tokenType token=0);
 
       // ### StatsClient Pure Virtuals ### //
       void onDescribeStats();
@@ -101,8 +407,41 @@ namespace aprscreate {
       unsigned int create_messages();
       unsigned int create_objects();
       unsigned int create_positions();
+      void report_create(const std::string &name, const size_t num_rows, const double elapsed);
 
       bool process_message(const std::string &body);
+      bool process_session(const std::string &body);
+      size_t preload_sessions();
+      const std::string frame_subscription(stomp::StompFrame *frame) const;
+      size_t drain_frames(framesType &frames);
+      void process_frames(framesType &frames, Dispatcher::entriesType &entries);
+      bool wants_messages() const { return !_dispatcher || _dispatch_reader; }
+      void stage(const std::string &body,
+                 stomp::StompFrame *frame,
+                 stagedType &wave,
+                 std::set<std::string> &sources,
+                 ackIdsType &last_ids);
+      void run_wave(stagedType &wave, ackIdsType &last_ids);
+      void ack_frame(stomp::StompFrame *frame, ackIdsType &last_ids);
+      size_t ack_finished();
+      void hold_frames(framesType &frames);
+      void resume_frames(framesType &frames);
+      bool is_session_frame(stomp::StompFrame *frame) const;
+      void release_frames(framesType &frames);
+      void adjust_flow(const size_t num_frames, const double elapsed);
+      int flow_prefetch() const;
+      bool is_paused();
+      static double now();
+      bool frame_timestamp(stomp::StompFrame *frame, double &ts);
+      void record_lag(const std::vector<double> &stamps, const double received_at, const double finished_at);
+      stomp::Stomp *stomp_create(const std::string &hosts, const bool heart_beat=true);
+      bool stomp_rebuild();
+      bool stomp_connect();
+      void stomp_dropped();
+      void stomp_warm_standby();
+      bool stomp_ack(const std::string &message_id, const std::string &subscription);
+      bool stomp_send(const std::string &dest, const std::string &body, const Publisher::tokenType token=0);
+      const std::string stomp_connected_to();
 
       struct process_message_t {
         std::string source;
@@ -122,6 +461,10 @@ namespace aprscreate {
       bool event_message_verify(process_message_t &pm);
 
       bool setMessageSessionInMemcached(const std::string &source);
+      pushResultEnum push_confirmed(const std::string &body, const sentTypeEnum type, const int id);
+      void set_unconfirmed_decay(const sentTypeEnum type, const int id, const std::string &decay_id);
+      bool is_unconfirmed(const sentTypeEnum type, const int id) const;
+      size_t confirm_sent();
 
     private:
       // constructor variables
@@ -137,25 +480,104 @@ namespace aprscreate {
       time_t _decay_retry;
       time_t _decay_timeout;
       time_t _session_expire;
+      double _sql_deadline;
+      time_t _sql_deadline_backoff;
+      double _sql_slow_query;
+      StoreBackend *_store_backend;
+      ConcurrentCache *_shared_cache;
+      SingleFlight *_single_flight;
+      size_t _l1_size;
+      time_t _l1_ttl;
+      time_t _l1_negative_ttl;
 
       std::string _stomp_dest_feeds_aprs_is;
       std::string _stomp_dest_push_aprs;
       std::string _stomp_dest_notify_msgs;
+      std::string _stomp_dest_notify_sessions;
+      time_t _session_push_ttl;
+      time_t _session_preload_at;	// when sessions are loaded from sql again
+      unsigned int _session_preload_seed;
       std::string _callsign;
       std::string _digis;
 
       Decay *_decay;
+      Suppress *_suppress;
+      JobPool *_pool;
       Store *_store;
       stomp::Stomp *_stomp;
+      StompIO *_io;			// owns _stomp's socket when set
+      unsigned int _io_generation;	// connection this batch was read on
+      unsigned int _generation;		// connects without an I/O thread
+      framesType _held;			// read while paused, not acked
+      unsigned int _held_generation;
+      Dispatcher *_dispatcher;
+      Publisher *_publisher;
+      Brokers *_brokers;
+      stomp::Stomp *_standby;		// connected to _standby_host, not subscribed
+      std::string _standby_host;
+      std::string _stomp_target;		// first host _stomp was built with
+      bool _stomp_standby;
+
+      struct reconnect_t {
+        unsigned int attempts;		// failed since we were last connected
+        int wait;			// ms the next idle() waits while disconnected
+        unsigned int seed;
+        time_t standby_at;		// next try at opening a standby
+      } _reconnect;
+      unsigned int _dispatch_shard;
+      bool _dispatch_reader;
 
       bool _connected;
       bool _console;
       bool _no_send;
 
+      CircuitBreaker::breaker_opts_t _breaker_opts;
+      MemcachedController::memcached_opts_t _memcached_opts;
+      MemcachedController *_memcached_pool;
+      unsigned int _memcached_refresh;
+
       struct create_timer_t {
         time_t last_try_at;
         time_t try_interval;
       } _create_timer;
+      unsigned int _create_threads;
+      size_t _create_threshold;
+      size_t _batch_size;
+      int _stomp_prefetch;
+
+      struct publish_opts_t {
+        bool enabled;
+        size_t flush_size;
+        int linger;
+        size_t max_queue;
+        size_t window;
+      } _publish_opts;
+
+      Publisher::tokenType _next_token;
+      unconfirmedType _unconfirmed;
+      unconfirmedRowsType _unconfirmed_rows;
+
+      struct flow_t {
+        double target;
+        size_t window;		// frames to drain next, up to _batch_size
+        size_t pause;
+        size_t resume;
+        bool paused;
+      } _flow;
+      bool _batch_ack_cumulative;
+      bool _stomp_io;
+      size_t _stomp_io_ring;
+
+      struct lag_t {
+        double warn;
+        time_t warned_at;
+      } _lag;
+
+      struct idle_t {
+        int min;
+        int max;
+        int wait;		// ms the next idle() will wait
+      } _idle;
 
       struct aprs_stats_t {
         unsigned int packet;
@@ -176,12 +598,41 @@ namespace aprscreate {
         unsigned int reject_tofast;
       }; // aprs_stats_t
 
+      // seconds from the producer's timestamp to us, bucketed like the
+      // query latencies
+      struct lag_stats_t {
+        unsigned int frames;
+        double total;
+        double max;
+        unsigned int buckets[kNumLagBuckets];
+      }; // lag_stats_t
+
+      static void init_lag(lag_stats_t &lag);
+      static void add_lag(lag_stats_t &lag, const double seconds);
+      static double percentile_lag(const lag_stats_t &lag, const double pct);
+      void report_lag(const std::string &name, const lag_stats_t &lag);
+      void datapoint_lag(const std::string &name, const lag_stats_t &lag);
+
       struct obj_stats_t {
         unsigned int connects;
         unsigned int disconnects;
+        unsigned int failovers;
         unsigned int packets;
         unsigned int frames_in;
         unsigned int frames_out;
+        unsigned int batches;
+        unsigned int waves;
+        unsigned int dispatched;
+        unsigned int acks;
+        unsigned int idles;
+        unsigned int pauses;
+        unsigned int shrinks;
+        unsigned int confirmed;
+        unsigned int unconfirmed_expired;
+        unsigned int positions_sent;
+        unsigned int positions_suppressed;
+        lag_stats_t lag_receive;
+        lag_stats_t lag_finish;
         time_t report_interval;
         time_t last_report_at;
         time_t created_at;
@@ -190,6 +641,14 @@ namespace aprscreate {
 
       struct obj_stompstats_t {
         aprs_stats_t aprs_stats;
+        unsigned int batches;
+        unsigned int batch_frames;
+        unsigned int dispatched;
+        unsigned int acks;
+        unsigned int positions_sent;
+        unsigned int positions_suppressed;
+        lag_stats_t lag_receive;
+        lag_stats_t lag_finish;
         time_t report_interval;
         time_t last_report_at;
         time_t created_at;
@@ -4,14 +4,24 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <signal.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include <openframe/openframe.h>
 
 #include "App.h"
 #include "Worker.h"
+#include "LocalBackend.h"
+#include "ConcurrentCache.h"
+#include "SingleFlight.h"
+#include "Suppress.h"
+#include "MemcachedController.h"
+#include "Dispatcher.h"
+#include "Brokers.h"
 
 #include "aprscreate.h"
 
@@ -22,11 +32,31 @@ namespace aprscreate {
 
   App::App(const std::string &prompt, const std::string &config, const bool console) :
     super(prompt, config, console) {
+    _local_backend = NULL;
+    _shared_cache = NULL;
+    _single_flight = NULL;
+    _suppress = NULL;
+    _memcached_pool = NULL;
+    _dispatcher = NULL;
+    _brokers = NULL;
+    MemcachedController::init_opts(_memcached_opts);
+
+    _wakeup_fd = eventfd(0, EFD_NONBLOCK);
   } // App::App
 
   App::~App() {
+    if (_wakeup_fd != -1) close(_wakeup_fd);
   } // App:~App
 
+  // Never read, once written every worker waiting on it returns for good.
+  void App::wakeup() {
+    if (_wakeup_fd == -1) return;
+
+    uint64_t one = 1;
+    ssize_t ret = write(_wakeup_fd, &one, sizeof(one));
+    (void) ret;
+  } // App::wakeup
+
   void App::onInitializeSystem() { }
 
   void App::onInitializeConfig() { }
@@ -55,7 +85,75 @@ namespace aprscreate {
     _stats->set_elogger(elogger(), elog_name());
     _stats->start();
 
+    // one in process store shared by every worker instead of MySQL
+    if (app->cfg->get_string("app.store.backend", "sql") == "local") {
+      _local_backend = new LocalBackend();
+      _local_backend->set_elogger(elogger(), elog_name());
+
+      std::string seed = app->cfg->get_string("app.store.local.seed", "");
+      if (seed.length()) _local_backend->load(seed);
+
+      LOG(LogNotice, << "*** Using local store backend" << std::endl);
+    } // if
+
+    // workers fall back to this for acks when memcached.host is empty
+    _shared_cache = new ConcurrentCache(app->cfg->get_int("app.cache.shared.shards", 16),
+                                        app->cfg->get_int("app.cache.shared.size", 65536));
+    _single_flight = new SingleFlight();
+
+    // the last broadcast of every station, whichever worker sent it
+    if (app->cfg->get_int("app.position.suppress.enabled", false)) {
+      _suppress = new Suppress();
+      _suppress->set_elogger(elogger(), elog_name());
+      _suppress->set_distance( atof( app->cfg->get_string("app.position.suppress.distance", "50").c_str() ) )
+                .set_course( app->cfg->get_int("app.position.suppress.course", 15) )
+                .set_speed( atof( app->cfg->get_string("app.position.suppress.speed", "5").c_str() ) )
+                .set_interval( app->cfg->get_int("app.position.suppress.interval", 1800) );
+    } // if
+
+    _memcached_opts.binary = app->cfg->get_int("app.memcached.binary", false);
+    _memcached_opts.nodelay = app->cfg->get_int("app.memcached.nodelay", true);
+    _memcached_opts.ketama = app->cfg->get_int("app.memcached.ketama", true);
+    _memcached_opts.noreply = app->cfg->get_int("app.memcached.noreply", false);
+    _memcached_opts.connect_timeout = app->cfg->get_int("app.memcached.timeout.connect", 250);
+    _memcached_opts.poll_timeout = app->cfg->get_int("app.memcached.timeout.poll", 250);
+    _memcached_opts.failure_limit = app->cfg->get_int("app.memcached.failure.limit", 3);
+    _memcached_opts.retry_timeout = app->cfg->get_int("app.memcached.failure.retry", 5);
+
+    // one fixed set of sockets for every thread instead of one per worker
+    int pool_size = app->cfg->get_int("app.memcached.pool.size", 0);
+    std::string memcached_host = app->cfg->get_string("app.threads.worker.memcached.host",
+                                                      _local_backend ? "" : "localhost");
+    if (pool_size > 0 && memcached_host.length()) {
+      _memcached_pool = new MemcachedController(memcached_host);
+      _memcached_pool->expire(Worker::kDefaultMemcachedExpire);
+      _memcached_pool->set_opts(_memcached_opts)
+                     .start_pool(pool_size, pool_size, app->cfg->get_int("app.memcached.pool.timeout", 100));
+      LOG(LogNotice, << "*** Memcached pool of " << pool_size << " connections" << std::endl);
+    } // if
+
     int num_workers = cfg->get_int("app.threads.worker", 0);
+
+    // every worker connects from this so they agree on which broker is
+    // best and spread their reconnects out
+    _brokers = new Brokers( app->cfg->get_string("app.threads.worker.stomp.hosts", "localhost:61613") );
+    _brokers->set_elogger(elogger(), elog_name());
+    _brokers->replace_stats(_stats, "aprscreate.brokers");
+    _brokers->set_probe_interval( app->cfg->get_int("app.threads.worker.stomp.brokers.probe.interval", 30) )
+             .set_probe_timeout( app->cfg->get_int("app.threads.worker.stomp.brokers.probe.timeout", 1000) )
+             .set_backoff( app->cfg->get_int("app.threads.worker.stomp.brokers.backoff.min", 500),
+                           app->cfg->get_int("app.threads.worker.stomp.brokers.backoff.max", 30000) );
+    _brokers->start();
+
+    // one worker reads the notify topic and shares it out, otherwise
+    // every worker would see and act on every message
+    std::string notify_mode = app->cfg->get_string("app.message.notify.mode", "each");
+    if (notify_mode == "fanout" && num_workers > 1) {
+      _dispatcher = new Dispatcher(num_workers, app->cfg->get_int("app.message.notify.rebalance", 64));
+      LOG(LogNotice, << "*** Messages fanned out to " << num_workers << " workers" << std::endl);
+    } // if
+    else if (notify_mode != "each")
+      LOG(LogNotice, << "*** Ignoring app.message.notify.mode \"" << notify_mode << "\", every worker subscribes" << std::endl);
     for(int i=0; i < num_workers; i++) {
       openframe::ThreadMessage *tm = new openframe::ThreadMessage(i+1);
       tm->var->push_void("app", app);
@@ -73,6 +171,8 @@ namespace aprscreate {
   void App::onDeinitializeDatabase() { }
   void App::onDeinitializeModules() { }
   void App::onDeinitializeThreads() {
+    wakeup();
+
     while(!_workers.empty()) {
       pthread_t thread_id = _workers.front();
       LOG(LogNotice, << "*** Waiting for WorkerThread " << thread_id << " to Deinitialize" << std::endl);
@@ -80,8 +180,19 @@ namespace aprscreate {
       _workers.pop_front();
     } // while
 
+    // reports through _stats so it goes first
+    if (_brokers) delete _brokers;
+    _brokers = NULL;
+
     _stats->stop();
     delete _stats;
+
+    if (_local_backend) delete _local_backend;
+    if (_shared_cache) delete _shared_cache;
+    if (_single_flight) delete _single_flight;
+    if (_suppress) delete _suppress;
+    if (_memcached_pool) delete _memcached_pool;
+    if (_dispatcher) delete _dispatcher;
   } // App::onDeinitializeThreads
 
   bool App::onRun() {
@@ -101,6 +212,7 @@ namespace aprscreate {
   void App::rcvSigint() {
     LOG(LogNotice, << "### SIGINT Received" << std::endl);
     set_done(true);
+    wakeup();
   } // App::rcvSigint
   void App::rcvSigpipe() {
     LOG(LogNotice, << "### SIGPIPE Received" << std::endl);
@@ -110,12 +222,14 @@ namespace aprscreate {
     openframe::ThreadMessage *tm = static_cast<openframe::ThreadMessage *>(arg);
     App *a = static_cast<App *>( tm->var->get_void("app") );
     openframe::LogObject::thread_id_t id = tm->var->get_uint("id");
+    // memcached isn't needed with the local backend unless asked for
+    std::string memcached_default = a->local_backend() ? "" : "localhost";
 
     Worker *worker = new Worker(id,
                                 a->cfg->get_string("app.threads.worker.stomp.hosts", "localhost:61613"),
                                 a->cfg->get_string("app.threads.worker.stomp.login"),
                                 a->cfg->get_string("app.threads.worker.stomp.passcode"),
-                                a->cfg->get_string("app.threads.worker.memcached.host", "localhost"),
+                                a->cfg->get_string("app.threads.worker.memcached.host", memcached_default),
                                 a->cfg->get_string("app.threads.worker.sql.host", "localhost"),
                                 a->cfg->get_string("app.threads.worker.sql.user"),
                                 a->cfg->get_string("app.threads.worker.sql.pass"),
@@ -128,14 +242,56 @@ namespace aprscreate {
     worker->set_console( a->is_console() )
            .set_no_send( a->cfg->get_int("app.message.no.send", true) )
            .set_session_expire( a->cfg->get_int("app.message.session.expire", 300) )
+           .set_session_push_ttl( a->cfg->get_int("app.message.session.push.ttl", 900) )
+           .set_stomp_dest_notify_messages( a->cfg->get_string("app.message.notify.destination", "/topic/notify.aprs.messages") )
+           .set_dispatcher( a->dispatcher(), id - 1, id == 1 )
+           .set_brokers( a->brokers() )
+           .set_stomp_standby( a->cfg->get_int("app.threads.worker.stomp.brokers.standby", false) )
+           .set_stomp_dest_notify_sessions( a->cfg->get_string("app.message.session.push.destination", "/topic/notify.aprs.sessions") )
            .set_digis( a->cfg->get_string("app.digis", "TCPIP*,qAC") )
-           .set_callsign( a->cfg->get_string("app.message.callsign", "") );
+           .set_callsign( a->cfg->get_string("app.message.callsign", "") )
+           .set_store_backend( a->local_backend() )
+           .set_shared_cache( a->shared_cache() )
+           .set_single_flight( a->single_flight() )
+           .set_sql_deadline( double(a->cfg->get_int("app.sql.deadline", 2000)) / 1000 )
+           .set_sql_deadline_backoff( a->cfg->get_int("app.sql.deadline.backoff", 10) )
+           .set_sql_slow_query( double(a->cfg->get_int("app.sql.slow", 500)) / 1000 )
+           .set_l1_size( a->cfg->get_int("app.cache.l1.size", 4096) )
+           .set_l1_ttl( a->cfg->get_int("app.cache.l1.ttl", 60) )
+           .set_l1_negative_ttl( a->cfg->get_int("app.cache.l1.negative.ttl", 30) )
+           .set_stomp_io( a->cfg->get_int("app.threads.worker.stomp.io.thread", false) )
+           .set_stomp_io_ring( a->cfg->get_int("app.threads.worker.stomp.io.ring", 2048) )
+           .set_publish( a->cfg->get_int("app.threads.worker.stomp.publish.enabled", false) )
+           .set_publish_flush_size( a->cfg->get_int("app.threads.worker.stomp.publish.flush", 64) )
+           .set_publish_linger( a->cfg->get_int("app.threads.worker.stomp.publish.linger", 5) )
+           .set_publish_window( a->cfg->get_int("app.threads.worker.stomp.publish.window", 0) )
+           .set_publish_max_queue( a->cfg->get_int("app.threads.worker.stomp.publish.max", 65536) )
+           .set_stomp_prefetch( a->cfg->get_int("app.threads.worker.stomp.prefetch", 1024) )
+           .set_flow_target( double(a->cfg->get_int("app.threads.worker.stomp.flow.target", 250)) / 1000 )
+           .set_flow_pause( a->cfg->get_int("app.message.notify.pause", 4096),
+                            a->cfg->get_int("app.message.notify.resume", 1024) )
+           .set_batch_size( a->cfg->get_int("app.threads.worker.stomp.batch.size", 64) )
+           .set_batch_ack_cumulative( a->cfg->get_int("app.threads.worker.stomp.batch.ack.cumulative", false) )
+           .set_lag_warn( a->cfg->get_int("app.threads.worker.lag.warn", 30) )
+           .set_idle_min( a->cfg->get_int("app.threads.worker.idle.min", 1) )
+           .set_idle_max( a->cfg->get_int("app.threads.worker.idle.max", 100) )
+           .set_create_threads( a->cfg->get_int("app.create.threads", 0) )
+           .set_create_threshold( a->cfg->get_int("app.create.threshold", 256) )
+           .set_suppress( a->suppress() )
+           .set_breaker_error_rate( a->cfg->get_int("app.memcached.breaker.error.rate", 50) )
+           .set_breaker_slow( double(a->cfg->get_int("app.memcached.breaker.slow", 100)) / 1000 )
+           .set_breaker_backoff( double(a->cfg->get_int("app.memcached.breaker.backoff", 500)) / 1000 )
+           .set_breaker_backoff_max( double(a->cfg->get_int("app.memcached.breaker.backoff.max", 60000)) / 1000 )
+           .set_breaker_trials( a->cfg->get_int("app.memcached.breaker.trials", 3) )
+           .set_memcached_opts( a->memcached_opts() )
+           .set_memcached_refresh( a->cfg->get_int("app.memcached.refresh.fraction", 50) )
+           .set_memcached_pool( a->memcached_pool() );
 
     worker->init();
 
     while( !a->is_done() ) {
       bool did_work = worker->run();
-      if (!did_work) sleep(2);
+      if (!did_work) worker->idle( a->wakeup_fd() );
     } // while
 
     delete worker;
@@ -0,0 +1,395 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <openframe/openframe.h>
+
+#include <Brokers.h>
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+/**************************************************************************
+ ** Brokers Class                                                        **
+ **************************************************************************/
+
+  const time_t Brokers::kDefaultProbeInterval		= 30;
+  const int Brokers::kDefaultProbeTimeout		= 1000;
+  const int Brokers::kDefaultBackoffMin			= 500;
+  const int Brokers::kDefaultBackoffMax			= 30000;
+  const double Brokers::kDefaultRttWeight		= 0.3;
+  const time_t Brokers::kDefaultReportInterval		= 5;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  Brokers::Brokers(const std::string &hosts,
+                   const openframe::LogObject::thread_id_t thread_id)
+          : openframe::LogObject(thread_id),
+            _probe_interval(kDefaultProbeInterval),
+            _probe_timeout(kDefaultProbeTimeout),
+            _backoff_min(kDefaultBackoffMin),
+            _backoff_max(kDefaultBackoffMax) {
+    pthread_mutex_init(&_lock, NULL);
+
+    // same list the stomp library takes, comma separated host:port
+    std::string::size_type start = 0;
+    while(start <= hosts.length()) {
+      std::string::size_type end = hosts.find(',', start);
+      if (end == std::string::npos) end = hosts.length();
+
+      std::string host = hosts.substr(start, end - start);
+      std::string::size_type first = host.find_first_not_of(" \t");
+      std::string::size_type last = host.find_last_not_of(" \t");
+      if (first != std::string::npos) {
+        broker_t b;
+        b.host = host.substr(first, last - first + 1);
+        b.name = b.host;
+        for(std::string::size_type i=0; i < b.name.length(); i++)
+          if (b.name[i] == '.' || b.name[i] == ':') b.name[i] = '_';
+        b.rtt = 0;
+        b.up = true;
+        b.probed = false;
+        b.probes = 0;
+        b.connects = 0;
+        b.disconnects = 0;
+        b.failures = 0;
+        b.connect_ms = 0;
+        _brokers.push_back(b);
+      } // if
+
+      start = end + 1;
+    } // while
+
+    _reported = _brokers;
+    _last_report_at = time(NULL);
+    _started = false;
+    _done = false;
+  } // Brokers::Brokers
+
+  Brokers::~Brokers() {
+    stop();
+    onDestroyStats();
+    pthread_mutex_destroy(&_lock);
+  } // Brokers::~Brokers
+
+  void Brokers::onDescribeStats() {
+    for(brokersType::const_iterator ptr = _brokers.begin(); ptr != _brokers.end(); ptr++) {
+      std::string name = "brokers.num." + ptr->name;
+      std::string desc = "brokers/" + ptr->host;
+      describe_root_stat(name+".up", desc+"/num up", openstats::graphTypeGauge, openstats::dataTypeInt);
+      describe_root_stat(name+".rtt", desc+"/num rtt ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_root_stat(name+".connect", desc+"/num connect ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_root_stat(name+".probes", desc+"/num probes", openstats::graphTypeCounter, openstats::dataTypeInt);
+      describe_root_stat(name+".connects", desc+"/num connects", openstats::graphTypeCounter, openstats::dataTypeInt);
+      describe_root_stat(name+".disconnects", desc+"/num disconnects", openstats::graphTypeCounter, openstats::dataTypeInt);
+      describe_root_stat(name+".failures", desc+"/num connect failures", openstats::graphTypeCounter, openstats::dataTypeInt);
+    } // for
+  } // Brokers::onDescribeStats
+
+  void Brokers::onDestroyStats() {
+    destroy_stat("brokers.num.*");
+  } // Brokers::onDestroyStats
+
+  void Brokers::start() {
+    if (_started) return;
+
+    pthread_create(&_thread, NULL, Brokers::ProbeThread, this);
+    _started = true;
+
+    TLOG(LogInfo, << "*** Brokers started, "
+                  << _brokers.size()
+                  << " hosts, probing every "
+                  << _probe_interval
+                  << "s" << std::endl);
+  } // Brokers::start
+
+  void Brokers::stop() {
+    if (!_started) return;
+
+    __atomic_store_n(&_done, true, __ATOMIC_RELEASE);
+    pthread_join(_thread, NULL);
+    _started = false;
+  } // Brokers::stop
+
+  /*****************
+   ** Worker Side **
+   *****************/
+
+  // needs _lock; up hosts we've timed quickest first, then the ones we
+  // haven't yet in the order given, anything down goes last but is still
+  // tried since probes can be wrong
+  void Brokers::ordered(std::vector<const broker_t *> &ret) {
+    std::vector<std::pair<double, size_t> > timed;
+    std::vector<const broker_t *> untimed, down;
+
+    for(size_t i=0; i < _brokers.size(); i++) {
+      const broker_t &b = _brokers[i];
+      if (!b.up) down.push_back(&b);
+      else if (b.probed) timed.push_back( std::make_pair(b.rtt, i) );
+      else untimed.push_back(&b);
+    } // for
+
+    std::stable_sort(timed.begin(), timed.end());
+    for(size_t i=0; i < timed.size(); i++)
+      ret.push_back(&_brokers[timed[i].second]);
+    ret.insert(ret.end(), untimed.begin(), untimed.end());
+    ret.insert(ret.end(), down.begin(), down.end());
+  } // Brokers::ordered
+
+  // host list for a new connection, best first
+  const std::string Brokers::hosts() {
+    std::vector<const broker_t *> order;
+    std::string ret;
+
+    pthread_mutex_lock(&_lock);
+    ordered(order);
+    for(size_t i=0; i < order.size(); i++) {
+      if (i) ret += ",";
+      ret += order[i]->host;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // Brokers::hosts
+
+  // the best host that's up and isn't the one we're on, "" if none
+  const std::string Brokers::standby(const std::string &primary) {
+    std::vector<const broker_t *> order;
+    std::string ret;
+
+    pthread_mutex_lock(&_lock);
+    ordered(order);
+    for(size_t i=0; i < order.size(); i++) {
+      if (!order[i]->up || order[i]->host == primary) continue;
+      ret = order[i]->host;
+      break;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // Brokers::standby
+
+  // Exponential with the lower half jittered, every worker dropped by the
+  // same broker comes back at a different time instead of all at once.
+  int Brokers::backoff(const unsigned int attempt, unsigned int &seed) const {
+    int cap = _backoff_max;
+    if (attempt < 16 && (_backoff_min << attempt) < _backoff_max)
+      cap = _backoff_min << attempt;
+    if (cap < 2) return cap;
+
+    return cap / 2 + rand_r(&seed) % (cap / 2 + 1);
+  } // Brokers::backoff
+
+  // needs _lock, the library may report a host with a different case or
+  // without the port so fall back to matching the name alone
+  Brokers::broker_t *Brokers::find(const std::string &host) {
+    for(brokersType::iterator ptr = _brokers.begin(); ptr != _brokers.end(); ptr++)
+      if (strcasecmp(ptr->host.c_str(), host.c_str()) == 0) return &(*ptr);
+
+    std::string name = host.substr(0, host.find(':'));
+    for(brokersType::iterator ptr = _brokers.begin(); ptr != _brokers.end(); ptr++)
+      if (strcasecmp(ptr->host.substr(0, ptr->host.find(':')).c_str(), name.c_str()) == 0) return &(*ptr);
+
+    return NULL;
+  } // Brokers::find
+
+  void Brokers::connected(const std::string &host, const double ms) {
+    pthread_mutex_lock(&_lock);
+    broker_t *b = find(host);
+    if (b) {
+      b->up = true;
+      b->connect_ms = ms;
+      b->connects++;
+    } // if
+    pthread_mutex_unlock(&_lock);
+  } // Brokers::connected
+
+  // down until a probe gets through, new connections try it last
+  void Brokers::disconnected(const std::string &host) {
+    pthread_mutex_lock(&_lock);
+    broker_t *b = find(host);
+    if (b) {
+      b->up = false;
+      b->disconnects++;
+    } // if
+    pthread_mutex_unlock(&_lock);
+  } // Brokers::disconnected
+
+  void Brokers::failed(const std::string &host) {
+    pthread_mutex_lock(&_lock);
+    broker_t *b = find(host);
+    if (b) {
+      b->up = false;
+      b->failures++;
+    } // if
+    pthread_mutex_unlock(&_lock);
+  } // Brokers::failed
+
+  void Brokers::snapshot(brokersType &brokers) {
+    pthread_mutex_lock(&_lock);
+    brokers = _brokers;
+    pthread_mutex_unlock(&_lock);
+  } // Brokers::snapshot
+
+  /*************
+   ** Thread **
+   *************/
+
+  // ms to open a TCP connection to host:port, -1 if it couldn't
+  double Brokers::probe(const std::string &host) {
+    std::string::size_type pos = host.rfind(':');
+    std::string name = host.substr(0, pos);
+    std::string port = pos == std::string::npos ? "61613" : host.substr(pos + 1);
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(name.c_str(), port.c_str(), &hints, &res) != 0) return -1;
+
+    openframe::Stopwatch sw;
+    sw.Start();
+
+    double ret = -1;
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd != -1) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+      int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+      if (rc != 0 && errno == EINPROGRESS) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+
+        int err = -1;
+        socklen_t len = sizeof(err);
+        if (poll(&pfd, 1, _probe_timeout) == 1
+            && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+          rc = 0;
+      } // if
+
+      if (rc == 0) ret = sw.Time() * 1000;
+      close(fd);
+    } // if
+
+    freeaddrinfo(res);
+    return ret;
+  } // Brokers::probe
+
+  void Brokers::probe() {
+    // hosts never change after we're built, only the rest needs the lock
+    for(size_t i=0; i < _brokers.size(); i++) {
+      double ms = probe(_brokers[i].host);
+
+      pthread_mutex_lock(&_lock);
+      broker_t &b = _brokers[i];
+      bool was_up = b.up;
+      b.probes++;
+      b.up = ms >= 0;
+      if (b.up) {
+        b.rtt = b.probed ? b.rtt + (ms - b.rtt) * kDefaultRttWeight : ms;
+        b.probed = true;
+      } // if
+      pthread_mutex_unlock(&_lock);
+
+      if (was_up != (ms >= 0))
+        TLOG(LogNotice, << "Broker " << _brokers[i].host
+                        << (ms >= 0 ? " is up, " : " is down")
+                        << (ms >= 0 ? openframe::stringify<double>(ms) + "ms" : "")
+                        << std::endl);
+    } // for
+  } // Brokers::probe
+
+  void Brokers::try_stats() {
+    if (_last_report_at > time(NULL) - kDefaultReportInterval) return;
+
+    brokersType brokers;
+    snapshot(brokers);
+
+    // counters go out as the change since the last report
+    for(size_t i=0; i < brokers.size(); i++) {
+      const broker_t &b = brokers[i];
+      const broker_t &r = _reported[i];
+      std::string name = "brokers.num." + b.name;
+
+      datapoint(name+".up", b.up);
+      datapoint_float(name+".rtt", b.rtt);
+      datapoint_float(name+".connect", b.connect_ms);
+      datapoint(name+".probes", b.probes - r.probes);
+      datapoint(name+".connects", b.connects - r.connects);
+      datapoint(name+".disconnects", b.disconnects - r.disconnects);
+      datapoint(name+".failures", b.failures - r.failures);
+    } // for
+
+    _reported = brokers;
+    _last_report_at = time(NULL);
+  } // Brokers::try_stats
+
+  // sleep in short slices so stop() isn't kept waiting
+  void Brokers::wait(const time_t seconds) {
+    for(int waited=0; waited < seconds * 10; waited++) {
+      if ( __atomic_load_n(&_done, __ATOMIC_ACQUIRE) ) return;
+      poll(NULL, 0, 100);
+    } // for
+  } // Brokers::wait
+
+  void Brokers::loop() {
+    time_t next_probe_at = 0;
+
+    while( !__atomic_load_n(&_done, __ATOMIC_ACQUIRE) ) {
+      if (_probe_interval && next_probe_at <= time(NULL)) {
+        probe();
+        next_probe_at = time(NULL) + _probe_interval;
+      } // if
+
+      try_stats();
+      wait(1);
+    } // while
+  } // Brokers::loop
+
+  void *Brokers::ProbeThread(void *arg) {
+    Brokers *brokers = static_cast<Brokers *>(arg);
+    brokers->loop();
+    return NULL;
+  } // Brokers::ProbeThread
+} // namespace aprscreate
@@ -0,0 +1,187 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#include "config.h"
+
+#include <string>
+#include <deque>
+#include <iostream>
+#include <algorithm>
+
+#include <sys/time.h>
+
+#include <openframe/openframe.h>
+
+#include <CircuitBreaker.h>
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+/**************************************************************************
+ ** CircuitBreaker Class                                                 **
+ **************************************************************************/
+  const double CircuitBreaker::kDefaultErrorRate		= 50.0;
+  const double CircuitBreaker::kDefaultSlow			= 0.1;
+  const unsigned int CircuitBreaker::kDefaultWindow		= 20;
+  const unsigned int CircuitBreaker::kDefaultMinCalls		= 5;
+  const double CircuitBreaker::kDefaultBackoff			= 0.5;
+  const double CircuitBreaker::kDefaultBackoffMax		= 60.0;
+  const unsigned int CircuitBreaker::kDefaultTrials		= 3;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  CircuitBreaker::CircuitBreaker(const openframe::LogObject::thread_id_t thread_id, const std::string &name)
+                 : openframe::LogObject(thread_id),
+                   _name(name) {
+    init_opts(_opts);
+
+    _state = breakerStateClosed;
+    _window_errors = 0;
+    _backoff = 0;
+    _open_until = 0;
+    _trial_calls = 0;
+    _trial_successes = 0;
+    _trips = 0;
+  } // CircuitBreaker::CircuitBreaker
+
+  CircuitBreaker::~CircuitBreaker() {
+  } // CircuitBreaker::~CircuitBreaker
+
+  void CircuitBreaker::init_opts(breaker_opts_t &opts) {
+    opts.error_rate = kDefaultErrorRate;
+    opts.slow = kDefaultSlow;
+    opts.window = kDefaultWindow;
+    opts.min_calls = kDefaultMinCalls;
+    opts.backoff = kDefaultBackoff;
+    opts.backoff_max = kDefaultBackoffMax;
+    opts.trials = kDefaultTrials;
+  } // CircuitBreaker::init_opts
+
+  double CircuitBreaker::now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + double(tv.tv_usec) / 1000000;
+  } // CircuitBreaker::now
+
+  bool CircuitBreaker::allow() {
+    switch(_state) {
+      case breakerStateClosed:
+        return true;
+      case breakerStateOpen:
+        if (now() < _open_until) return false;
+
+        _state = breakerStateHalfOpen;
+        _trial_calls = 0;
+        _trial_successes = 0;
+        TLOG(LogInfo, << "breaker{"
+                      << _name
+                      << "} half open, probing"
+                      << std::endl);
+        // fall through
+      case breakerStateHalfOpen:
+        if (_trial_calls >= _opts.trials) return false;
+        _trial_calls++;
+        return true;
+    } // switch
+
+    return true;
+  } // CircuitBreaker::allow
+
+  void CircuitBreaker::record(const bool ok, const double elapsed) {
+    bool failed = !ok || elapsed > _opts.slow;
+
+    if (_state == breakerStateHalfOpen) {
+      if (failed) {
+        trip();
+        return;
+      } // if
+
+      if (++_trial_successes >= _opts.trials) close();
+      return;
+    } // if
+
+    if (_state != breakerStateClosed) return;
+
+    _window.push_back(failed);
+    if (failed) _window_errors++;
+    while(_window.size() > _opts.window) {
+      if (_window.front()) _window_errors--;
+      _window.pop_front();
+    } // while
+
+    if (_window.size() < _opts.min_calls) return;
+
+    double rate = double(_window_errors) * 100 / _window.size();
+    if (rate >= _opts.error_rate) trip();
+  } // CircuitBreaker::record
+
+  void CircuitBreaker::trip() {
+    // back to back trips without closing in between back off harder
+    _backoff = _state == breakerStateHalfOpen ? std::min(_backoff * 2, _opts.backoff_max)
+                                              : _opts.backoff;
+    _open_until = now() + _backoff;
+    _state = breakerStateOpen;
+    _window.clear();
+    _window_errors = 0;
+    _trips++;
+
+    TLOG(LogWarn, << "breaker{"
+                  << _name
+                  << "} open for "
+                  << int(_backoff * 1000)
+                  << "ms"
+                  << std::endl);
+  } // CircuitBreaker::trip
+
+  void CircuitBreaker::close() {
+    _state = breakerStateClosed;
+    _backoff = 0;
+    _window.clear();
+    _window_errors = 0;
+
+    TLOG(LogNotice, << "breaker{"
+                    << _name
+                    << "} closed"
+                    << std::endl);
+  } // CircuitBreaker::close
+
+  std::ostream &operator<<(std::ostream &ss, const CircuitBreaker::breakerStateEnum state) {
+    switch(state) {
+      case CircuitBreaker::breakerStateClosed:
+        ss << "closed";
+        break;
+      case CircuitBreaker::breakerStateHalfOpen:
+        ss << "half open";
+        break;
+      case CircuitBreaker::breakerStateOpen:
+        ss << "open";
+        break;
+      default:
+        ss << "unknown";
+        break;
+    } // switch
+    return ss;
+  } // operator<<
+} // namespace aprscreate
@@ -0,0 +1,152 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#include "config.h"
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <time.h>
+#include <pthread.h>
+
+#include <ConcurrentCache.h>
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** ConcurrentCache Class                                                **
+ **************************************************************************/
+  const unsigned int ConcurrentCache::kDefaultShards			= 16;
+  const ConcurrentCache::entriesSizeType ConcurrentCache::kDefaultMaxSize	= 65536;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  ConcurrentCache::ConcurrentCache(const unsigned int num_shards, const entriesSizeType max_size) {
+    unsigned int n = num_shards ? num_shards : 1;
+    for(unsigned int i=0; i < n; i++) {
+      cache_shard_t *s = new cache_shard_t;
+      pthread_mutex_init(&s->lock, NULL);
+      _shards.push_back(s);
+    } // for
+
+    _max_shard_size = max_size / n;
+    if (!_max_shard_size) _max_shard_size = 1;
+  } // ConcurrentCache::ConcurrentCache
+
+  ConcurrentCache::~ConcurrentCache() {
+    for(shardsType::iterator ptr = _shards.begin(); ptr != _shards.end(); ptr++) {
+      pthread_mutex_destroy(&(*ptr)->lock);
+      delete *ptr;
+    } // for
+  } // ConcurrentCache::~ConcurrentCache
+
+  ConcurrentCache::cache_shard_t *ConcurrentCache::shard(const std::string &key) const {
+    // FNV-1a, cheap and spreads callsigns well enough
+    unsigned int hash = 2166136261U;
+    for(std::string::size_type i=0; i < key.length(); i++) {
+      hash ^= (unsigned char) key[i];
+      hash *= 16777619U;
+    } // for
+
+    return _shards[hash % _shards.size()];
+  } // ConcurrentCache::shard
+
+  bool ConcurrentCache::get(const std::string &ns, const std::string &key, std::string &value) {
+    std::string k = ns+":"+key;
+    cache_shard_t *s = shard(k);
+    bool found = false;
+
+    pthread_mutex_lock(&s->lock);
+    entriesType::iterator ptr = s->entries.find(k);
+    if (ptr != s->entries.end()) {
+      if (ptr->second.expire_at > time(NULL)) {
+        value = ptr->second.value;
+        found = true;
+      } // if
+      else remove(s, ptr);
+    } // if
+    pthread_mutex_unlock(&s->lock);
+
+    return found;
+  } // ConcurrentCache::get
+
+  void ConcurrentCache::put(const std::string &ns, const std::string &key, const std::string &value, const time_t ttl) {
+    if (ttl <= 0) return;
+
+    std::string k = ns+":"+key;
+    cache_shard_t *s = shard(k);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&s->lock);
+    entriesType::iterator ptr = s->entries.find(k);
+    if (ptr != s->entries.end()) {
+      // rewritten, it's the newest now
+      s->order.splice(s->order.end(), s->order, ptr->second.order);
+      ptr->second.value = value;
+      ptr->second.expire_at = now + ttl;
+      pthread_mutex_unlock(&s->lock);
+      return;
+    } // if
+
+    // full, make room with the oldest rather than grow unbounded
+    while(!s->order.empty() && s->entries.size() >= _max_shard_size)
+      remove(s, s->entries.find( s->order.front() ));
+
+    cache_entry_t &entry = s->entries[k];
+    entry.value = value;
+    entry.expire_at = now + ttl;
+    entry.order = s->order.insert(s->order.end(), k);
+    pthread_mutex_unlock(&s->lock);
+  } // ConcurrentCache::put
+
+  void ConcurrentCache::erase(const std::string &ns, const std::string &key) {
+    std::string k = ns+":"+key;
+    cache_shard_t *s = shard(k);
+
+    pthread_mutex_lock(&s->lock);
+    entriesType::iterator ptr = s->entries.find(k);
+    if (ptr != s->entries.end()) remove(s, ptr);
+    pthread_mutex_unlock(&s->lock);
+  } // ConcurrentCache::erase
+
+  // caller holds the shard lock
+  void ConcurrentCache::remove(cache_shard_t *s, entriesType::iterator ptr) {
+    s->order.erase(ptr->second.order);
+    s->entries.erase(ptr);
+  } // ConcurrentCache::remove
+
+  ConcurrentCache::entriesSizeType ConcurrentCache::size() {
+    entriesSizeType ret = 0;
+    for(shardsType::iterator ptr = _shards.begin(); ptr != _shards.end(); ptr++) {
+      pthread_mutex_lock(&(*ptr)->lock);
+      ret += (*ptr)->entries.size();
+      pthread_mutex_unlock(&(*ptr)->lock);
+    } // for
+
+    return ret;
+  } // ConcurrentCache::size
+} // namespace aprscreate
@@ -37,6 +37,9 @@
 #include <ctype.h>
 #include <math.h>
 
+#include <errmsg.h>
+#include <mysqld_error.h>
+
 #include <openframe/openframe.h>
 #include <aprs/APRS.h>
 
@@ -49,556 +52,539 @@ namespace aprscreate {
    ** DBI Class                                                     **
    **************************************************************************/
 
+  const double DBI::kDefaultSlowQuery				= 0.5;
+  const unsigned int DBI::kDefaultTimeout			= 2;
+  // upper bound of each latency bucket in seconds, last one catches the rest
+  const double DBI::kLatencyBuckets[DBI::kNumLatencyBuckets]	= { 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0, 0 };
+
   /******************************
    ** Constructor / Destructor **
    ******************************/
 
   DBI::DBI(const openframe::LogObject::thread_id_t thread_id,
-                         const std::string &db,
                          const std::string &host,
                          const std::string &user,
-                         const std::string &pass)
+                         const std::string &pass,
+                         const std::string &db)
              : openframe::LogObject(thread_id),
-               openframe::DBI(db, host, user, pass) {
+               _sqlpp(NULL),
+               _slow_query(kDefaultSlowQuery),
+               _timeout(kDefaultTimeout),
+               _timed_out(false),
+               _db(db),
+               _host(host),
+               _user(user),
+               _pass(pass) {
   } // DBI::DBI
 
   DBI::~DBI() {
+    for(queriesType::iterator ptr = _queries.begin(); ptr != _queries.end(); ptr++)
+      delete ptr->second;
+    if (_sqlpp) delete _sqlpp;
   } // DBI::~DBI
 
+  DBI &DBI::init() {
+    _sqlpp = new mysqlpp::Connection(true);
+    _sqlpp->set_option( new mysqlpp::ConnectTimeoutOption(_timeout) );
+    _sqlpp->set_option( new mysqlpp::ReadTimeoutOption(_timeout) );
+    _sqlpp->set_option( new mysqlpp::WriteTimeoutOption(_timeout) );
+    // a timed out read drops the connection, the next call reconnects
+    _sqlpp->set_option( new mysqlpp::ReconnectOption(true) );
+    // procedures return a status result after their rows
+    _sqlpp->set_option( new mysqlpp::MultiResultsOption(true) );
+
+    connect();
+    prepare_queries();
+    return *this;
+  } // DBI::init
+
+  bool DBI::connect() {
+    try {
+      _sqlpp->connect(_db.c_str(), _host.c_str(), _user.c_str(), _pass.c_str());
+    } // try
+    catch(const mysqlpp::Exception &e) {
+      TLOG(LogWarn, << "*** MySQL++ Error{connect}: "
+                    << _host
+                    << " " << e.what()
+                    << std::endl);
+      return false;
+    } // catch
+
+    TLOG(LogInfo, << "*** MySQL++ Connected to "
+                  << _host
+                  << ", timeout "
+                  << _timeout
+                  << "s" << std::endl);
+    return true;
+  } // DBI::connect
+
   void DBI::prepare_queries() {
-    add_query("CALL_getLastMessageId", "CALL getLastMessageId(%0q:source)");
-    add_query("CALL_getPendingPositions", "CALL getPendingPositions()");
-    add_query("CALL_setPositionSent", "CALL setPositionSent(%0:id, %1:broadcast_ts)");
-    add_query("CALL_setPositionError", "CALL setPositionError(%0:id)");
-    add_query("CALL_getPendingObjects", "CALL getPendingObjects(%0:timestamp)");
-    add_query("CALL_setObjectSent", "CALL setObjectSent(%0:id, %1q:decay_id, %2:broadcast_ts)");
-    add_query("CALL_setObjectError", "CALL setObjectError(%0:id)");
-    add_query("CALL_getPendingMessages", "CALL getPendingMessages()");
-    add_query("CALL_setMessageAck", "CALL setMessageAck(%0q:source, %1q:target, %2q:msgack)");
-    add_query("CALL_setMessageSent", "CALL setMessageSent(%0:id, %1q:decay_id, %2:broadcast_ts)");
-    add_query("CALL_setMessageError", "CALL setMessageError(%0:id)");
-    add_query("CALL_isUserSession", "CALL isUserSession(%0q:callsign, %1:timestamp)");
-    add_query("CALL_getMessageDecayId", "CALL getMessageDecayId(%0q:source, %1q:target, %2q:msgack)");
-    add_query("CALL_getObjectDecayId", "CALL getObjectDecayId(%0q:name, %1q:start_ts)");
+    track_query("getLastMessageId", "CALL getLastMessageId(%0q:source)");
+    track_query("getPendingPositions", "CALL getPendingPositions()");
+    track_query("setPositionSent", "CALL setPositionSent(%0:id, %1:broadcast_ts)");
+    track_query("setPositionError", "CALL setPositionError(%0:id)");
+    track_query("getPendingObjects", "CALL getPendingObjects(%0:timestamp)");
+    track_query("setObjectSent", "CALL setObjectSent(%0:id, %1q:decay_id, %2:broadcast_ts)");
+    track_query("setObjectError", "CALL setObjectError(%0:id)");
+    track_query("getPendingMessages", "CALL getPendingMessages()");
+    track_query("setMessageAck", "CALL setMessageAck(%0q:source, %1q:target, %2q:msgack)");
+    track_query("setMessageSent", "CALL setMessageSent(%0:id, %1q:decay_id, %2:broadcast_ts)");
+    track_query("setMessageError", "CALL setMessageError(%0:id)");
+    track_query("isUserSession", "CALL isUserSession(%0q:callsign, %1:timestamp)");
+    track_query("getActiveSessions", "CALL getActiveSessions(%0:timestamp)");
+    // callsigns is a comma separated list for FIND_IN_SET()
+    track_query("getSessionsFor", "CALL getSessionsFor(%0q:callsigns, %1:timestamp)");
+    track_query("getMessageDecayId", "CALL getMessageDecayId(%0q:source, %1q:target, %2q:msgack)");
+    track_query("getObjectDecayId", "CALL getObjectDecayId(%0q:name, %1q:start_ts)");
 
     // verify queries
-    add_query("CALL_getUserMsgChecksum", "CALL getUserMsgChecksum(%0:id, %1q:callsign, %2q:key)");
-    add_query("CALL_setUserMsgChecksum", "CALL setUserMsgChecksum(%0:id, %1q:callsign, %2q:key)");
-    add_query("CALL_setTryUserVerify", "CALL setTryUserVerify(%0:id, %1q:callsign, %2q:key)");
-    add_query("CALL_isUserVerified", "CALL isUserVerified(%0q:callsign)");
+    track_query("getUserMsgChecksum", "CALL getUserMsgChecksum(%0:id, %1q:callsign, %2q:key)");
+    track_query("setUserMsgChecksum", "CALL setUserMsgChecksum(%0:id, %1q:callsign, %2q:key)");
+    track_query("setTryUserVerify", "CALL setTryUserVerify(%0:id, %1q:callsign, %2q:key)");
+    track_query("isUserVerified", "CALL isUserVerified(%0q:callsign)");
 
   } // DBI::prepare_queries
 
-  bool DBI::isUserVerified(const std::string &callsign) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_isUserVerified");
+  /**********************
+   ** Query Accounting **
+   **********************/
+
+  void DBI::track_query(const std::string &name, const std::string &sql) {
+    mysqlpp::Query *query = new mysqlpp::Query( _sqlpp->query( sql.c_str() ) );
+    query->parse();
+    _queries[name] = query;
+
+    query_stats_t stats;
+    init_query_stats(stats);
+    _query_stats[name] = stats;
+  } // DBI::track_query
+
+  void DBI::init_query_stats(query_stats_t &stats) {
+    memset(&stats, '\0', sizeof(query_stats_t) );
+  } // DBI::init_query_stats
+
+  void DBI::clear_query_stats() {
+    for(queryStatsType::iterator ptr = _query_stats.begin(); ptr != _query_stats.end(); ptr++)
+      init_query_stats(ptr->second);
+  } // DBI::clear_query_stats
+
+  void DBI::merge_query_stats(query_stats_t &to, const query_stats_t &from) {
+    to.calls += from.calls;
+    to.errors += from.errors;
+    to.slow += from.slow;
+    to.total += from.total;
+    if (from.max > to.max) to.max = from.max;
+    for(unsigned int i=0; i < kNumLatencyBuckets; i++)
+      to.buckets[i] += from.buckets[i];
+  } // DBI::merge_query_stats
+
+  // estimate from the buckets, good enough to see which procedure hurts
+  double DBI::percentile_query_stats(const query_stats_t &stats, const double pct) {
+    if (!stats.calls) return 0;
+
+    unsigned int want = (unsigned int) ceil(stats.calls * pct / 100.0);
+    unsigned int seen = 0;
+    for(unsigned int i=0; i < kNumLatencyBuckets-1; i++) {
+      seen += stats.buckets[i];
+      if (seen >= want) return kLatencyBuckets[i];
+    } // for
+
+    return stats.max;
+  } // DBI::percentile_query_stats
+
+  void DBI::record(const std::string &name, const query_params_t &params, const double elapsed, const bool ok) {
+    query_stats_t &stats = _query_stats[name];
+
+    stats.calls++;
+    if (!ok) stats.errors++;
+    stats.total += elapsed;
+    if (elapsed > stats.max) stats.max = elapsed;
+
+    unsigned int i;
+    for(i=0; i < kNumLatencyBuckets-1 && elapsed > kLatencyBuckets[i]; i++);
+    stats.buckets[i]++;
+
+    if (elapsed < _slow_query) return;
+
+    stats.slow++;
+    TLOG(LogWarn, << "*** MySQL++ Slow{"
+                  << name
+                  << "}: "
+                  << int(elapsed*1000)
+                  << "ms ("
+                  << params.text.str()
+                  << ")"
+                  << std::endl);
+  } // DBI::record
+
+  bool DBI::store(const std::string &name, query_params_t &params, resultType &res) {
+    mysqlpp::Query *query = _queries[name];
+    openframe::Stopwatch sw;
+    bool ok = true;
+
+    _timed_out = false;
+    if (is_missing(name)) return false;
+
+    sw.Start();
 
-    resultType res;
     try {
-      res = query->store(callsign);
-      numRows = res.num_rows();
+      // never got through at startup, reconnects after that are automatic
+      if (!_sqlpp->connected() && !connect()) {
+        _timed_out = true;
+        record(name, params, sw.Time(), false);
+        return false;
+      } // if
+
+      res = query->store(params.parms);
 
       while(query->more_results()) query->store_next();
     } // try
     catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{isUserVerified}: #"
+      TLOG(LogWarn, << "*** MySQL++ Error{"
+                    << name
+                    << "}: #"
                     << e.errnum()
                     << " " << e.what()
                     << std::endl);
+      ok = false;
+      _timed_out = e.errnum() == CR_SERVER_LOST || e.errnum() == CR_SERVER_GONE_ERROR;
+      if (e.errnum() == ER_SP_DOES_NOT_EXIST) {
+        TLOG(LogWarn, << "*** MySQL++ " << name << " isn't installed, not calling it again" << std::endl);
+        _missing.insert(name);
+      } // if
     } // catch
     catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{isUserVerified}: "
+      TLOG(LogWarn, << "*** MySQL++ Error{"
+                    << name
+                    << "}: "
                     << " " << e.what()
                     << std::endl);
+      ok = false;
     } // catch
 
-    return numRows ? true : false;
-  } // DBI::isUserVerified
+    record(name, params, sw.Time(), ok);
 
-  bool DBI::getUserMsgChecksum(const std::string &id, const std::string &callsign, const std::string &key) {
-    int numRows = 0;
+    return ok;
+  } // DBI::store
 
-    mysqlpp::Query *query = q("CALL_getUserMsgChecksum");
+  bool DBI::execute(const std::string &name, query_params_t &params, simpleResultType &res) {
+    mysqlpp::Query *query = _queries[name];
+    openframe::Stopwatch sw;
+    bool ok = true;
+
+    _timed_out = false;
+    if (is_missing(name)) return false;
+
+    sw.Start();
 
-    resultType res;
     try {
-      res = query->store(id, callsign, key);
-      numRows = res.num_rows();
+      // never got through at startup, reconnects after that are automatic
+      if (!_sqlpp->connected() && !connect()) {
+        _timed_out = true;
+        record(name, params, sw.Time(), false);
+        return false;
+      } // if
+
+      res = query->execute(params.parms);
 
       while(query->more_results()) query->store_next();
     } // try
     catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getUserMsgChecksum}: #"
+      TLOG(LogWarn, << "*** MySQL++ Error{"
+                    << name
+                    << "}: #"
                     << e.errnum()
                     << " " << e.what()
                     << std::endl);
+      ok = false;
+      _timed_out = e.errnum() == CR_SERVER_LOST || e.errnum() == CR_SERVER_GONE_ERROR;
+      if (e.errnum() == ER_SP_DOES_NOT_EXIST) {
+        TLOG(LogWarn, << "*** MySQL++ " << name << " isn't installed, not calling it again" << std::endl);
+        _missing.insert(name);
+      } // if
     } // catch
     catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getUserMsgChecksum}: "
+      TLOG(LogWarn, << "*** MySQL++ Error{"
+                    << name
+                    << "}: "
                     << " " << e.what()
                     << std::endl);
+      ok = false;
     } // catch
 
-    return numRows ? true : false;
-  } // DBI::getUserMsgChecksum
+    record(name, params, sw.Time(), ok);
 
-  openframe::DBI::simpleResultSizeType DBI::setUserMsgChecksum(const std::string &id,
-                                                                      const std::string &source,
-                                                                      const std::string &key) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setUserMsgChecksum");
+    return ok;
+  } // DBI::execute
 
-    DBI::simpleResultType res;
+  // a missing column or bad conversion is a failed call, not an escape
+  bool DBI::first_field(const std::string &name, const resultType &res, const char *column, std::string &ret) {
     try {
-      res = query->execute(id, source, key);
-
-      numRows = res.rows();
-
-      while(query->more_results()) query->store_next();
+      res[0][column].to_string(ret);
     } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setUserMsgChecksum}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
     catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setUserMsgChecksum}: "
+      TLOG(LogWarn, << "*** MySQL++ Error{"
+                    << name
+                    << "}: "
                     << " " << e.what()
                     << std::endl);
+      return false;
     } // catch
 
-    return numRows;
+    return true;
+  } // DBI::first_field
+
+  void DBI::to_result(const resultType &from, StoreResult &to) {
+    to.reset();
+
+    size_t num_fields = from.num_fields();
+    for(size_t i=0; i < num_fields; i++)
+      to.add_column( from.field_name(i) );
+
+    to.reserve( from.num_rows() );
+    for(resultSizeType i=0; i < from.num_rows(); i++) {
+      StoreRow &row = to.add_row();
+      for(size_t j=0; j < num_fields; j++) {
+        const mysqlpp::String &field = from[i][j];
+        if (field.is_null())
+          row.push( StoreField() );
+        else
+          row.push( StoreField( std::string(field.data(), field.length()) ) );
+      } // for
+    } // for
+  } // DBI::to_result
+
+  /*************
+   ** Queries **
+   *************/
+
+  bool DBI::isUserVerified(const std::string &callsign) {
+    query_params_t params;
+    params << callsign;
+
+    resultType res;
+    if (!store("isUserVerified", params, res)) return false;
+
+    return res.num_rows() ? true : false;
+  } // DBI::isUserVerified
+
+  bool DBI::getUserMsgChecksum(const std::string &id, const std::string &callsign, const std::string &key) {
+    query_params_t params;
+    params << id << callsign << key;
+
+    resultType res;
+    if (!store("getUserMsgChecksum", params, res)) return false;
+
+    return res.num_rows() ? true : false;
+  } // DBI::getUserMsgChecksum
+
+  openframe::DBI::simpleResultSizeType DBI::setUserMsgChecksum(const std::string &id,
+                                                                      const std::string &source,
+                                                                      const std::string &key) {
+    query_params_t params;
+    params << id << source << key;
+
+    simpleResultType res;
+    if (!execute("setUserMsgChecksum", params, res)) return 0;
+
+    return res.rows();
   } // DBI::setUserMsgChecksum
 
   openframe::DBI::simpleResultSizeType DBI::setTryUserVerify(const std::string &id,
                                                                     const std::string &source,
                                                                     const std::string &key) {
-    int numRows = 0;
+    query_params_t params;
+    params << id << source << key;
 
-    mysqlpp::Query *query = q("CALL_setTryUserVerify");
+    simpleResultType res;
+    if (!execute("setTryUserVerify", params, res)) return 0;
 
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id, source, key);
+    return res.rows();
+  } // DBI::setTryUserVerify
 
-      numRows = res.rows();
+  bool DBI::isUserSession(const std::string &callsign, const time_t start_ts) {
+    query_params_t params;
+    params << callsign << start_ts;
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setTryUserVerify}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setTryUserVerify}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    resultType res;
+    if (!store("isUserSession", params, res)) return false;
 
-    return numRows;
-  } // DBI::setTryUserVerify
+    return res.num_rows() ? true : false;
+  } // DBI::isUserSession
 
-  bool DBI::isUserSession(const std::string &callsign, const time_t start_ts) {
-    int numRows = 0;
+  openframe::DBI::resultSizeType DBI::getActiveSessions(const time_t start_ts, StoreResult &res) {
+    query_params_t params;
+    params << start_ts;
 
-    mysqlpp::Query *query = q("CALL_isUserSession");
+    resultType sql_res;
+    if (!store("getActiveSessions", params, sql_res)) return 0;
 
-    resultType res;
-    try {
-      res = query->store(callsign, start_ts);
-      numRows = res.num_rows();
+    to_result(sql_res, res);
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{isUserSession}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{isUserSession}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    return res.num_rows();
+  } // DBI::getActiveSessions
 
-    return numRows ? true : false;
-  } // DBI::isUserSession
+  openframe::DBI::resultSizeType DBI::getSessionsFor(const std::vector<std::string> &callsigns,
+                                                     const time_t start_ts,
+                                                     StoreResult &res) {
+    std::string list;
+    for(std::vector<std::string>::const_iterator ptr = callsigns.begin(); ptr != callsigns.end(); ptr++)
+      list += (list.length() ? "," : "") + *ptr;
 
-  openframe::DBI::resultSizeType DBI::getLastMessageId(const std::string &source, std::string &id) {
-    int numRows = 0;
+    query_params_t params;
+    params << list << start_ts;
 
-    mysqlpp::Query *query = q("CALL_getLastMessageId");
+    resultType sql_res;
+    if (!store("getSessionsFor", params, sql_res)) return 0;
 
-    resultType res;
-    try {
-      res = query->store(source);
-      numRows = res.num_rows();
+    to_result(sql_res, res);
 
-      if (numRows) res[0]["id"].to_string(id);
+    return res.num_rows();
+  } // DBI::getSessionsFor
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getLastMessageId}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getLastMessageId}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+  openframe::DBI::resultSizeType DBI::getLastMessageId(const std::string &source, std::string &id) {
+    query_params_t params;
+    params << source;
+
+    resultType res;
+    if (!store("getLastMessageId", params, res)) return 0;
+    if (!res.num_rows()) return 0;
 
-    return numRows;
+    return first_field("getLastMessageId", res, "id", id) ? res.num_rows() : 0;
   } // DBI::getLastMessageId
 
   openframe::DBI::resultSizeType DBI::getMessageDecayId(const std::string &source, const std::string &target,
                                                                const std::string &msgack, std::string &id) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_getMessageDecayId");
+    query_params_t params;
+    params << source << target << msgack;
 
     resultType res;
-    try {
-      res = query->store(source, target, msgack);
-      numRows = res.num_rows();
-
-      if (numRows) res[0]["decay_id"].to_string(id);
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getMessageDecayId}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getMessageDecayId}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    if (!store("getMessageDecayId", params, res)) return 0;
+    if (!res.num_rows()) return 0;
 
-    return numRows;
+    return first_field("getMessageDecayId", res, "decay_id", id) ? res.num_rows() : 0;
   } // DBI::getMessageDecayId
 
   openframe::DBI::resultSizeType DBI::getObjectDecayId(const std::string &name, const time_t start_ts,
                                                               std::string &id) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_getObjectDecayId");
+    query_params_t params;
+    params << name << start_ts;
 
     resultType res;
-    try {
-      res = query->store(name, start_ts);
-      numRows = res.num_rows();
+    if (!store("getObjectDecayId", params, res)) return 0;
+    if (!res.num_rows()) return 0;
 
-      if (numRows) res[0]["decay_id"].to_string(id);
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getObjectDecayId}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getObjectDecayId}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-
-    return numRows;
+    return first_field("getObjectDecayId", res, "decay_id", id) ? res.num_rows() : 0;
   } // DBI::getObjectDecayId
 
-  openframe::DBI::resultSizeType DBI::getPendingMessages(openframe::DBI::resultType &res) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_getPendingMessages");
-
-    try {
-      res = query->store();
+  openframe::DBI::resultSizeType DBI::getPendingMessages(StoreResult &res) {
+    query_params_t params;
 
-      numRows = res.num_rows();
+    resultType sql_res;
+    if (!store("getPendingMessages", params, sql_res)) return 0;
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getPendingMessages}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getPendingMessages}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    to_result(sql_res, res);
 
-    return numRows;
+    return res.num_rows();
   } // DBI::getPendingMessages
 
   openframe::DBI::simpleResultSizeType DBI::setMessageAck(const std::string &source,
                                                                  const std::string &target,
                                                                  const std::string &msgack) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setMessageAck");
-
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(source, target, msgack);
+    query_params_t params;
+    params << source << target << msgack;
 
-      numRows = res.rows();
+    simpleResultType res;
+    if (!execute("setMessageAck", params, res)) return 0;
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setMessageAck}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setMessageAck}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-
-    return numRows;
+    return res.rows();
   } // DBI::setMessageAck
 
   openframe::DBI::simpleResultSizeType DBI::setMessageSent(const int id,
                                                                   const std::string &decay_id,
                                                                   const time_t broadcast_ts) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setMessageSent");
+    query_params_t params;
+    params << id << decay_id << broadcast_ts;
 
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id, decay_id, broadcast_ts);
-
-      numRows = res.rows();
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setMessageSent}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setMessageSent}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    simpleResultType res;
+    if (!execute("setMessageSent", params, res)) return 0;
 
-    return numRows;
+    return res.rows();
   } // DBI::setMessageSent
 
   openframe::DBI::simpleResultSizeType DBI::setMessageError(const int id) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setMessageError");
-
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id);
+    query_params_t params;
+    params << id;
 
-      numRows = res.rows();
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setMessageError}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setMessageError}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    simpleResultType res;
+    if (!execute("setMessageError", params, res)) return 0;
 
-    return numRows;
+    return res.rows();
   } // DBI::setMessageError
 
-  openframe::DBI::resultSizeType DBI::getPendingObjects(const time_t now, openframe::DBI::resultType &res) {
-    int numRows = 0;
+  openframe::DBI::resultSizeType DBI::getPendingObjects(const time_t now, StoreResult &res) {
+    query_params_t params;
+    params << now;
 
-    mysqlpp::Query *query = q("CALL_getPendingObjects");
+    resultType sql_res;
+    if (!store("getPendingObjects", params, sql_res)) return 0;
 
-    try {
-      res = query->store(now);
+    to_result(sql_res, res);
 
-      numRows = res.num_rows();
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getPendingObjects}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getPendingObjects}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-
-    return numRows;
+    return res.num_rows();
   } // DBI::getPendingObjects
 
   openframe::DBI::simpleResultSizeType DBI::setObjectSent(const int id,
                                                                  const std::string &decay_id,
                                                                  const time_t broadcast_ts) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setObjectSent");
-
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id, decay_id, broadcast_ts);
-
-      numRows = res.rows();
+    query_params_t params;
+    params << id << decay_id << broadcast_ts;
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setObjectSent}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setObjectSent}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    simpleResultType res;
+    if (!execute("setObjectSent", params, res)) return 0;
 
-    return numRows;
+    return res.rows();
   } // DBI::setObjectSent
 
   openframe::DBI::simpleResultSizeType DBI::setObjectError(const int id) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setObjectError");
-
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id);
+    query_params_t params;
+    params << id;
 
-      numRows = res.rows();
+    simpleResultType res;
+    if (!execute("setObjectError", params, res)) return 0;
 
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setObjectError}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setObjectError}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-
-    return numRows;
+    return res.rows();
   } // DBI::setObjectError
 
-  openframe::DBI::resultSizeType DBI::getPendingPositions(openframe::DBI::resultType &res) {
-    int numRows = 0;
+  openframe::DBI::resultSizeType DBI::getPendingPositions(StoreResult &res) {
+    query_params_t params;
 
-    mysqlpp::Query *query = q("CALL_getPendingPositions");
+    resultType sql_res;
+    if (!store("getPendingPositions", params, sql_res)) return 0;
 
-    try {
-      res = query->store();
-
-      numRows = res.num_rows();
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getPendingPositions}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{getPendingPositions}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    to_result(sql_res, res);
 
-    return numRows;
+    return res.num_rows();
   } // DBI::getPendingPositions
 
   openframe::DBI::simpleResultSizeType DBI::setPositionSent(const int id,
                                                                    const time_t broadcast_ts) {
-    int numRows = 0;
+    query_params_t params;
+    params << id << broadcast_ts;
 
-    mysqlpp::Query *query = q("CALL_setPositionSent");
+    simpleResultType res;
+    if (!execute("setPositionSent", params, res)) return 0;
 
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id, broadcast_ts);
-
-      numRows = res.rows();
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setPositionSent}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setPositionSent}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-
-    return numRows;
+    return res.rows();
   } // DBI::setPositionSent
 
   openframe::DBI::simpleResultSizeType DBI::setPositionError(const int id) {
-    int numRows = 0;
-
-    mysqlpp::Query *query = q("CALL_setPositionError");
-
-    DBI::simpleResultType res;
-    try {
-      res = query->execute(id);
+    query_params_t params;
+    params << id;
 
-      numRows = res.rows();
-
-      while(query->more_results()) query->store_next();
-    } // try
-    catch(const mysqlpp::BadQuery &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setPositionError}: #"
-                    << e.errnum()
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
-    catch(const mysqlpp::Exception &e) {
-      TLOG(LogWarn, << "*** MySQL++ Error{setPositionError}: "
-                    << " " << e.what()
-                    << std::endl);
-    } // catch
+    simpleResultType res;
+    if (!execute("setPositionError", params, res)) return 0;
 
-    return numRows;
+    return res.rows();
   } // DBI::setPositionError
 } // namespace aprscreate
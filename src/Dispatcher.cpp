@@ -0,0 +1,338 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <Dispatcher.h>
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** Dispatcher Class                                                     **
+ **************************************************************************/
+  const Dispatcher::entriesSizeType Dispatcher::kDefaultRebalanceDepth	= 64;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  Dispatcher::Dispatcher(const unsigned int num_shards, const entriesSizeType rebalance_depth)
+             : _rebalance_depth(rebalance_depth) {
+    pthread_mutex_init(&_route_lock, NULL);
+    pthread_mutex_init(&_acks_lock, NULL);
+    _acks_fd = eventfd(0, EFD_NONBLOCK);
+
+    unsigned int n = num_shards ? num_shards : 1;
+    for(unsigned int i=0; i < n; i++) {
+      dispatch_shard_t *s = new dispatch_shard_t;
+      pthread_mutex_init(&s->lock, NULL);
+      s->depth = 0;
+      s->ready_fd = eventfd(0, EFD_NONBLOCK);
+      s->pushed = 0;
+      s->popped = 0;
+      s->stolen = 0;
+      s->moved = 0;
+      s->max_depth = 0;
+      _shards.push_back(s);
+    } // for
+  } // Dispatcher::Dispatcher
+
+  Dispatcher::~Dispatcher() {
+    for(shardsType::iterator ptr = _shards.begin(); ptr != _shards.end(); ptr++) {
+      if ((*ptr)->ready_fd != -1) close((*ptr)->ready_fd);
+      pthread_mutex_destroy(&(*ptr)->lock);
+      delete *ptr;
+    } // for
+
+    if (_acks_fd != -1) close(_acks_fd);
+    pthread_mutex_destroy(&_acks_lock);
+    pthread_mutex_destroy(&_route_lock);
+  } // Dispatcher::~Dispatcher
+
+  unsigned int Dispatcher::hash(const std::string &key) const {
+    // FNV-1a, same as the shared cache
+    unsigned int hash = 2166136261U;
+    for(std::string::size_type i=0; i < key.length(); i++) {
+      hash ^= (unsigned char) key[i];
+      hash *= 16777619U;
+    } // for
+
+    return hash % _shards.size();
+  } // Dispatcher::hash
+
+  // needs _route_lock
+  unsigned int Dispatcher::route(const std::string &key) {
+    routesType::const_iterator ptr = _routes.find(key);
+    if (ptr != _routes.end()) return ptr->second;
+    return hash(key);
+  } // Dispatcher::route
+
+  unsigned int Dispatcher::push(const std::string &key, const std::string &body, const double timestamp) {
+    dispatch_ack_t ack;
+    ack.generation = 0;
+    return push(key, body, timestamp, ack);
+  } // Dispatcher::push
+
+  // returns the shard it went to
+  unsigned int Dispatcher::push(const std::string &key,
+                                const std::string &body,
+                                const double timestamp,
+                                const dispatch_ack_t &ack) {
+    pthread_mutex_lock(&_route_lock);
+    unsigned int i = route(key);
+    dispatch_shard_t *s = _shards[i];
+    pthread_mutex_lock(&s->lock);
+
+    // a backed up shard hands new keys to whoever is least busy, only
+    // keys it has nothing of so their order can't change
+    if (_rebalance_depth && s->depth >= _rebalance_depth && !s->pending.count(key)) {
+      unsigned int least = i;
+      for(unsigned int j=0; j < _shards.size(); j++) {
+        if (__atomic_load_n(&_shards[j]->depth, __ATOMIC_RELAXED) < __atomic_load_n(&_shards[least]->depth, __ATOMIC_RELAXED))
+          least = j;
+      } // for
+
+      if (least != i && __atomic_load_n(&_shards[least]->depth, __ATOMIC_RELAXED) * 2 < s->depth) {
+        pthread_mutex_unlock(&s->lock);
+        i = least;
+        s = _shards[i];
+        pthread_mutex_lock(&s->lock);
+
+        if (i == hash(key)) _routes.erase(key);
+        else _routes[key] = i;
+        s->moved++;
+      } // if
+    } // if
+
+    dispatch_entry_t entry;
+    entry.key = key;
+    entry.body = body;
+    entry.timestamp = timestamp;
+    entry.ack = ack;
+    append(s, entry);
+
+    pthread_mutex_unlock(&s->lock);
+    pthread_mutex_unlock(&_route_lock);
+    return i;
+  } // Dispatcher::push
+
+  // needs the shard's lock
+  void Dispatcher::append(dispatch_shard_t *s, const dispatch_entry_t &entry) {
+    bool was_empty = s->queue.empty();
+    s->queue.push_back(entry);
+    s->queued[entry.key]++;
+    s->pending[entry.key]++;
+    s->pushed++;
+    __atomic_store_n(&s->depth, s->queue.size(), __ATOMIC_RELAXED);
+    if (s->queue.size() > s->max_depth) s->max_depth = s->queue.size();
+
+    // only the first one needs to wake the owner
+    if (was_empty) ready(s);
+  } // Dispatcher::append
+
+  void Dispatcher::ready(dispatch_shard_t *s) {
+    if (s->ready_fd == -1) return;
+
+    uint64_t one = 1;
+    ssize_t ret = write(s->ready_fd, &one, sizeof(one));
+    (void) ret;
+  } // Dispatcher::ready
+
+  // Entries stay pending against their key until done() so nothing moves
+  // the key while the owner still has some of its frames in hand.
+  Dispatcher::entriesSizeType Dispatcher::pop(const unsigned int shard, entriesType &out, const entriesSizeType max) {
+    dispatch_shard_t *s = _shards[shard % _shards.size()];
+    entriesSizeType num_popped = 0;
+
+    pthread_mutex_lock(&s->lock);
+    while(!s->queue.empty() && num_popped < max) {
+      dispatch_entry_t &entry = s->queue.front();
+      countsType::iterator ptr = s->queued.find(entry.key);
+      if (ptr != s->queued.end() && --ptr->second == 0) s->queued.erase(ptr);
+
+      out.push_back(entry);
+      s->queue.pop_front();
+      num_popped++;
+    } // while
+    s->popped += num_popped;
+    __atomic_store_n(&s->depth, s->queue.size(), __ATOMIC_RELAXED);
+
+    // reset under the lock so a push can't slip in between
+    if (s->queue.empty() && s->ready_fd != -1) {
+      uint64_t count;
+      ssize_t ret = read(s->ready_fd, &count, sizeof(count));
+      (void) ret;
+    } // if
+    pthread_mutex_unlock(&s->lock);
+
+    return num_popped;
+  } // Dispatcher::pop
+
+  // the popped entries once they've been handled, their acks go to
+  // whoever reads finished()
+  void Dispatcher::done(const unsigned int shard, const entriesType &entries) {
+    if (entries.empty()) return;
+
+    unsigned int i = shard % _shards.size();
+    dispatch_shard_t *s = _shards[i];
+
+    pthread_mutex_lock(&_route_lock);
+    pthread_mutex_lock(&s->lock);
+    for(entriesType::const_iterator ptr = entries.begin(); ptr != entries.end(); ptr++) {
+      countsType::iterator cptr = s->pending.find(ptr->key);
+      if (cptr == s->pending.end() || --cptr->second) continue;
+      s->pending.erase(cptr);
+
+      // nothing left anywhere, it can go back home
+      routesType::iterator rptr = _routes.find(ptr->key);
+      if (rptr != _routes.end() && rptr->second == i) _routes.erase(rptr);
+    } // for
+    pthread_mutex_unlock(&s->lock);
+    pthread_mutex_unlock(&_route_lock);
+
+    pthread_mutex_lock(&_acks_lock);
+    bool was_empty = _acks.empty();
+    for(entriesType::const_iterator ptr = entries.begin(); ptr != entries.end(); ptr++)
+      if (ptr->ack.message_id.length()) _acks.push_back(ptr->ack);
+
+    if (was_empty && !_acks.empty() && _acks_fd != -1) {
+      uint64_t one = 1;
+      ssize_t ret = write(_acks_fd, &one, sizeof(one));
+      (void) ret;
+    } // if
+    pthread_mutex_unlock(&_acks_lock);
+  } // Dispatcher::done
+
+  // acks for everything done() since the last call
+  size_t Dispatcher::finished(acksType &ret) {
+    pthread_mutex_lock(&_acks_lock);
+    ret.insert(ret.end(), _acks.begin(), _acks.end());
+    size_t num_acks = _acks.size();
+    _acks.clear();
+
+    if (_acks_fd != -1) {
+      uint64_t count;
+      ssize_t rret = read(_acks_fd, &count, sizeof(count));
+      (void) rret;
+    } // if
+    pthread_mutex_unlock(&_acks_lock);
+
+    return num_acks;
+  } // Dispatcher::finished
+
+  // An idle worker takes every queued entry of one key from the busiest
+  // shard, the oldest key whose owner has none of it in hand, and the key
+  // follows it over.
+  Dispatcher::entriesSizeType Dispatcher::steal(const unsigned int shard) {
+    unsigned int thief = shard % _shards.size();
+
+    pthread_mutex_lock(&_route_lock);
+
+    unsigned int victim = thief;
+    entriesSizeType most = 1;
+    for(unsigned int j=0; j < _shards.size(); j++) {
+      entriesSizeType depth = __atomic_load_n(&_shards[j]->depth, __ATOMIC_RELAXED);
+      if (j == thief || depth <= most) continue;
+      victim = j;
+      most = depth;
+    } // for
+
+    if (victim == thief) {
+      pthread_mutex_unlock(&_route_lock);
+      return 0;
+    } // if
+
+    dispatch_shard_t *v = _shards[victim];
+    entriesType taken;
+    std::string key;
+    bool found = false;
+
+    pthread_mutex_lock(&v->lock);
+    for(entriesType::const_iterator ptr = v->queue.begin(); !found && ptr != v->queue.end(); ptr++) {
+      if (v->pending[ptr->key] != v->queued[ptr->key]) continue;
+      key = ptr->key;
+      found = true;
+    } // for
+
+    if (found) {
+      entriesType kept;
+      for(entriesType::const_iterator ptr = v->queue.begin(); ptr != v->queue.end(); ptr++) {
+        if (ptr->key == key) taken.push_back(*ptr);
+        else kept.push_back(*ptr);
+      } // for
+      v->queue.swap(kept);
+      v->queued.erase(key);
+      v->pending.erase(key);
+      __atomic_store_n(&v->depth, v->queue.size(), __ATOMIC_RELAXED);
+    } // if
+    pthread_mutex_unlock(&v->lock);
+
+    if (!taken.empty()) {
+      if (thief == hash(key)) _routes.erase(key);
+      else _routes[key] = thief;
+
+      dispatch_shard_t *t = _shards[thief];
+      pthread_mutex_lock(&t->lock);
+      for(entriesType::const_iterator ptr = taken.begin(); ptr != taken.end(); ptr++)
+        append(t, *ptr);
+      t->pushed -= taken.size();
+      t->stolen += taken.size();
+      pthread_mutex_unlock(&t->lock);
+    } // if
+
+    pthread_mutex_unlock(&_route_lock);
+    return taken.size();
+  } // Dispatcher::steal
+
+  Dispatcher::entriesSizeType Dispatcher::depth(const unsigned int shard) {
+    return __atomic_load_n(&_shards[shard % _shards.size()]->depth, __ATOMIC_RELAXED);
+  } // Dispatcher::depth
+
+  // counters since the last call, the depth is as of now
+  void Dispatcher::stats(const unsigned int shard, dispatch_stats_t &ret) {
+    dispatch_shard_t *s = _shards[shard % _shards.size()];
+
+    pthread_mutex_lock(&s->lock);
+    ret.pushed = s->pushed;
+    ret.popped = s->popped;
+    ret.stolen = s->stolen;
+    ret.moved = s->moved;
+    ret.depth = s->queue.size();
+    ret.max_depth = s->max_depth;
+    s->pushed = 0;
+    s->popped = 0;
+    s->stolen = 0;
+    s->moved = 0;
+    s->max_depth = s->queue.size();
+    pthread_mutex_unlock(&s->lock);
+  } // Dispatcher::stats
+} // namespace aprscreate
@@ -0,0 +1,158 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <new>
+#include <string>
+#include <cassert>
+#include <iostream>
+
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+
+#include <JobPool.h>
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+/**************************************************************************
+ ** JobPool Class                                                        **
+ **************************************************************************/
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  JobPool::JobPool(const openframe::LogObject::thread_id_t thread_id, const unsigned int num_threads)
+          : openframe::LogObject(thread_id),
+            _num_threads(num_threads) {
+    pthread_mutex_init(&_lock, NULL);
+    pthread_cond_init(&_work_cond, NULL);
+    pthread_cond_init(&_done_cond, NULL);
+
+    _jobs = NULL;
+    _next = 0;
+    _pending = 0;
+    _done = false;
+  } // JobPool::JobPool
+
+  JobPool::~JobPool() {
+    stop();
+
+    pthread_cond_destroy(&_done_cond);
+    pthread_cond_destroy(&_work_cond);
+    pthread_mutex_destroy(&_lock);
+  } // JobPool::~JobPool
+
+  void JobPool::start() {
+    for(unsigned int i=0; i < _num_threads; i++) {
+      pthread_t thread_id;
+      pthread_create(&thread_id, NULL, JobPool::PoolThread, this);
+      _threads.push_back(thread_id);
+    } // for
+
+    TLOG(LogInfo, << "*** JobPool started with "
+                  << _num_threads
+                  << " threads"
+                  << std::endl);
+  } // JobPool::start
+
+  void JobPool::stop() {
+    pthread_mutex_lock(&_lock);
+    _done = true;
+    pthread_cond_broadcast(&_work_cond);
+    pthread_mutex_unlock(&_lock);
+
+    while(!_threads.empty()) {
+      pthread_join(_threads.back(), NULL);
+      _threads.pop_back();
+    } // while
+  } // JobPool::stop
+
+  void JobPool::run(jobsType &jobs) {
+    if (jobs.empty()) return;
+
+    pthread_mutex_lock(&_lock);
+    _jobs = &jobs;
+    _next = 0;
+    _pending = jobs.size();
+    pthread_cond_broadcast(&_work_cond);
+    pthread_mutex_unlock(&_lock);
+
+    // help out instead of sitting idle
+    jobsType *j;
+    jobsSizeType i;
+    while( next(j, i) ) {
+      (*j)[i]->run();
+      finish();
+    } // while
+
+    pthread_mutex_lock(&_lock);
+    while(_pending) pthread_cond_wait(&_done_cond, &_lock);
+    _jobs = NULL;
+    pthread_mutex_unlock(&_lock);
+  } // JobPool::run
+
+  bool JobPool::next(jobsType *&jobs, jobsSizeType &i) {
+    pthread_mutex_lock(&_lock);
+    bool ok = _jobs && _next < _jobs->size();
+    if (ok) {
+      jobs = _jobs;
+      i = _next++;
+    } // if
+    pthread_mutex_unlock(&_lock);
+
+    return ok;
+  } // JobPool::next
+
+  void JobPool::finish() {
+    pthread_mutex_lock(&_lock);
+    if (--_pending == 0) pthread_cond_signal(&_done_cond);
+    pthread_mutex_unlock(&_lock);
+  } // JobPool::finish
+
+  void *JobPool::PoolThread(void *arg) {
+    JobPool *pool = static_cast<JobPool *>(arg);
+
+    pthread_mutex_lock(&pool->_lock);
+    while(true) {
+      while(!pool->_done
+            && (pool->_jobs == NULL || pool->_next >= pool->_jobs->size()))
+        pthread_cond_wait(&pool->_work_cond, &pool->_lock);
+
+      if (pool->_done) break;
+
+      Job *job = (*pool->_jobs)[pool->_next++];
+      pthread_mutex_unlock(&pool->_lock);
+
+      job->run();
+
+      pthread_mutex_lock(&pool->_lock);
+      if (--pool->_pending == 0) pthread_cond_signal(&pool->_done_cond);
+    } // while
+    pthread_mutex_unlock(&pool->_lock);
+
+    return NULL;
+  } // JobPool::PoolThread
+} // namespace aprscreate
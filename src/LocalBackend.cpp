@@ -0,0 +1,574 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+
+#include <time.h>
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+
+#include "LocalBackend.h"
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+  /**************************************************************************
+   ** LocalBackend Class                                                   **
+   **************************************************************************/
+
+  // a worker that doesn't mark a row it was handed within this long, a
+  // stalled store or a packet still waiting on its receipt, has it handed
+  // out again the same as the sql backend would
+  const time_t LocalBackend::kDefaultClaimTtl		= 60;
+  // how long sent messages are kept around for their acks
+  const time_t LocalBackend::kDefaultSentTtl		= 3600;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  LocalBackend::LocalBackend(const openframe::LogObject::thread_id_t thread_id)
+               : openframe::LogObject(thread_id) {
+    pthread_mutex_init(&_lock, NULL);
+
+    _next_id = 1;
+
+    // same columns the stored procedures hand back
+    to_columns("id,source,target,message,local", _message_columns);
+    to_columns("id,name,source,latitude,longitude,symbol_table,symbol_code,decay_id,local,"
+               "speed,course,altitude,status,kill,broadcast_ts,expire_ts,beacon", _object_columns);
+    to_columns("id,source,latitude,longitude,symbol_table,symbol_code,local,"
+               "speed,course,altitude,status", _position_columns);
+  } // LocalBackend::LocalBackend
+
+  LocalBackend::~LocalBackend() {
+    pthread_mutex_destroy(&_lock);
+  } // LocalBackend::~LocalBackend
+
+  void LocalBackend::to_columns(const char *list, columnsType &columns) {
+    std::stringstream s(list);
+    std::string column;
+    while( std::getline(s, column, ',') ) columns.push_back(column);
+  } // LocalBackend::to_columns
+
+  /*************
+   ** Loading **
+   *************/
+
+  // One record per line; the record type followed by tab separated
+  // key=value pairs, e.g.
+  //
+  //   position<TAB>source=N0CALL<TAB>latitude=34.1<TAB>longitude=-118.2 ...
+  //
+  // Types are message, object, position, session and verify.
+  size_t LocalBackend::load(const std::string &filename) {
+    std::ifstream in(filename.c_str());
+    if (!in.is_open()) {
+      TLOG(LogWarn, << "local{load} unable to open "
+                    << filename
+                    << std::endl);
+      return 0;
+    } // if
+
+    size_t num_loaded = 0;
+    std::string line;
+    while( std::getline(in, line) ) {
+      if (!line.length() || line[0] == '#') continue;
+
+      std::stringstream s(line);
+      std::string type, pair;
+      std::getline(s, type, '\t');
+
+      fieldsType fields;
+      while( std::getline(s, pair, '\t') ) {
+        std::string::size_type pos = pair.find('=');
+        if (pos == std::string::npos) continue;
+        fields[pair.substr(0, pos)] = pair.substr(pos+1);
+      } // while
+
+      if (add(type, fields)) num_loaded++;
+    } // while
+
+    TLOG(LogNotice, << "local{load} loaded "
+                    << num_loaded
+                    << " records from "
+                    << filename
+                    << std::endl);
+
+    return num_loaded;
+  } // LocalBackend::load
+
+  bool LocalBackend::add(const std::string &type, const fieldsType &fields) {
+    if (type == "message") add_message(fields);
+    else if (type == "object") add_object(fields);
+    else if (type == "position") add_position(fields);
+    else if (type == "session") {
+      fieldsType::const_iterator callsign = fields.find("callsign");
+      fieldsType::const_iterator active = fields.find("active");
+      if (callsign == fields.end()) return false;
+      add_session(callsign->second, active != fields.end() ? atoi(active->second.c_str()) : 0);
+    } // else if
+    else if (type == "verify") {
+      fieldsType::const_iterator id = fields.find("id");
+      fieldsType::const_iterator callsign = fields.find("callsign");
+      fieldsType::const_iterator key = fields.find("key");
+      if (id == fields.end() || callsign == fields.end() || key == fields.end()) return false;
+      add_verify(id->second, callsign->second, key->second);
+    } // else if
+    else return false;
+
+    return true;
+  } // LocalBackend::add
+
+  int LocalBackend::insert(rowsType &rows, const fieldsType &fields) {
+    pthread_mutex_lock(&_lock);
+    int id = _next_id++;
+    local_row_t &row = rows[id];
+    row.state = rowStatePending;
+    row.claimed_at = 0;
+    row.fields = fields;
+    row.fields["id"] = openframe::stringify<int>(id);
+    pthread_mutex_unlock(&_lock);
+
+    return id;
+  } // LocalBackend::insert
+
+  int LocalBackend::add_message(const fieldsType &fields) {
+    return insert(_messages, fields);
+  } // LocalBackend::add_message
+
+  int LocalBackend::add_object(const fieldsType &fields) {
+    fieldsType f;
+    f["broadcast_ts"] = "0";
+    f["expire_ts"] = "0";
+    f["beacon"] = "1800";
+    f["kill"] = "N";
+
+    for(fieldsType::const_iterator ptr = fields.begin(); ptr != fields.end(); ptr++)
+      f[ptr->first] = ptr->second;
+
+    return insert(_objects, f);
+  } // LocalBackend::add_object
+
+  int LocalBackend::add_position(const fieldsType &fields) {
+    return insert(_positions, fields);
+  } // LocalBackend::add_position
+
+  // an active_ts of 0 never expires, handy for load tests
+  void LocalBackend::add_session(const std::string &callsign, const time_t active_ts) {
+    pthread_mutex_lock(&_lock);
+    _sessions[openframe::StringTool::toUpper(callsign)] = active_ts;
+    pthread_mutex_unlock(&_lock);
+  } // LocalBackend::add_session
+
+  void LocalBackend::add_verify(const std::string &id, const std::string &callsign, const std::string &key) {
+    pthread_mutex_lock(&_lock);
+    _verify_keys[id] = openframe::StringTool::toUpper(callsign) + ":" + openframe::StringTool::toUpper(key);
+    pthread_mutex_unlock(&_lock);
+  } // LocalBackend::add_verify
+
+  /*************
+   ** Results **
+   *************/
+
+  void LocalBackend::init_result(const columnsType &columns, StoreResult &res) {
+    res.reset();
+    for(columnsType::const_iterator ptr = columns.begin(); ptr != columns.end(); ptr++)
+      res.add_column(*ptr);
+  } // LocalBackend::init_result
+
+  void LocalBackend::to_result(const local_row_t &row, const columnsType &columns, StoreResult &res) {
+    StoreRow &r = res.add_row();
+    for(columnsType::const_iterator ptr = columns.begin(); ptr != columns.end(); ptr++) {
+      fieldsType::const_iterator field = row.fields.find(*ptr);
+      if (field == row.fields.end() || !field->second.length())
+        r.push( StoreField() );
+      else
+        r.push( StoreField(field->second) );
+    } // for
+  } // LocalBackend::to_result
+
+  // needs _lock; pending rows and claims nobody followed up on
+  bool LocalBackend::claim(local_row_t &row, const time_t now) {
+    bool ok = row.state == rowStatePending
+              || (row.state == rowStateClaimed && row.claimed_at < now - kDefaultClaimTtl);
+    if (!ok) return false;
+
+    row.state = rowStateClaimed;
+    row.claimed_at = now;
+    return true;
+  } // LocalBackend::claim
+
+  // needs _lock; drops rows nothing will ask about again and moves ptr
+  // past them, sent messages are kept a while for their acks
+  bool LocalBackend::purge(rowsType &rows, rowsType::iterator &ptr, const time_t now) {
+    local_row_t &row = ptr->second;
+    bool ok = row.state == rowStateDone
+              || row.state == rowStateError
+              || (row.state == rowStateSent
+                  && &rows == &_messages
+                  && atoi( row.fields["broadcast_ts"].c_str() ) < now - kDefaultSentTtl);
+    if (!ok) return false;
+
+    rows.erase(ptr++);
+    return true;
+  } // LocalBackend::purge
+
+  openframe::DBI::simpleResultSizeType LocalBackend::set_state(rowsType &rows, const int id, const rowStateEnum state) {
+    rowsType::iterator ptr = rows.find(id);
+    if (ptr == rows.end()) return 0;
+
+    ptr->second.state = state;
+    return 1;
+  } // LocalBackend::set_state
+
+  /******************
+   ** Verification **
+   ******************/
+
+  bool LocalBackend::isUserVerified(const std::string &callsign) {
+    pthread_mutex_lock(&_lock);
+    bool ret = _verified.find( openframe::StringTool::toUpper(callsign) ) != _verified.end();
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::isUserVerified
+
+  bool LocalBackend::getUserMsgChecksum(const std::string &id, const std::string &callsign, const std::string &key) {
+    std::string checksum = id + ":" + openframe::StringTool::toUpper(callsign) + ":" + key;
+
+    pthread_mutex_lock(&_lock);
+    bool ret = _checksums.find(checksum) != _checksums.end();
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::getUserMsgChecksum
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setUserMsgChecksum(const std::string &id,
+                                                                       const std::string &callsign,
+                                                                       const std::string &key) {
+    std::string checksum = id + ":" + openframe::StringTool::toUpper(callsign) + ":" + key;
+
+    pthread_mutex_lock(&_lock);
+    bool ok = _checksums.insert(checksum).second;
+    pthread_mutex_unlock(&_lock);
+
+    return ok ? 1 : 0;
+  } // LocalBackend::setUserMsgChecksum
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setTryUserVerify(const std::string &id,
+                                                                     const std::string &callsign,
+                                                                     const std::string &key) {
+    std::string want = openframe::StringTool::toUpper(callsign) + ":" + openframe::StringTool::toUpper(key);
+    openframe::DBI::simpleResultSizeType ret = 0;
+
+    pthread_mutex_lock(&_lock);
+    stringMapType::iterator ptr = _verify_keys.find(id);
+    if (ptr != _verify_keys.end() && ptr->second == want) {
+      _verified.insert( openframe::StringTool::toUpper(callsign) );
+      _verify_keys.erase(ptr);
+      ret = 1;
+    } // if
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setTryUserVerify
+
+  /**************
+   ** Sessions **
+   **************/
+
+  bool LocalBackend::isUserSession(const std::string &callsign, const time_t start_ts) {
+    pthread_mutex_lock(&_lock);
+    sessionsType::iterator ptr = _sessions.find( openframe::StringTool::toUpper(callsign) );
+    bool ret = ptr != _sessions.end()
+               && (ptr->second == 0 || ptr->second >= start_ts);
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::isUserSession
+
+  openframe::DBI::resultSizeType LocalBackend::getActiveSessions(const time_t start_ts, StoreResult &res) {
+    res.reset();
+    res.add_column("callsign");
+
+    pthread_mutex_lock(&_lock);
+    for(sessionsType::iterator ptr = _sessions.begin(); ptr != _sessions.end(); ptr++) {
+      if (ptr->second != 0 && ptr->second < start_ts) continue;
+      res.add_row().push( StoreField(ptr->first) );
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return res.num_rows();
+  } // LocalBackend::getActiveSessions
+
+  openframe::DBI::resultSizeType LocalBackend::getSessionsFor(const std::vector<std::string> &callsigns,
+                                                              const time_t start_ts,
+                                                              StoreResult &res) {
+    res.reset();
+    res.add_column("callsign");
+
+    pthread_mutex_lock(&_lock);
+    for(std::vector<std::string>::const_iterator ptr = callsigns.begin(); ptr != callsigns.end(); ptr++) {
+      sessionsType::iterator sptr = _sessions.find( openframe::StringTool::toUpper(*ptr) );
+      if (sptr == _sessions.end()) continue;
+      if (sptr->second != 0 && sptr->second < start_ts) continue;
+      res.add_row().push( StoreField(sptr->first) );
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return res.num_rows();
+  } // LocalBackend::getSessionsFor
+
+  /**************
+   ** Messages **
+   **************/
+
+  // there is no inbound history here to learn reply-ack ids from
+  openframe::DBI::resultSizeType LocalBackend::getLastMessageId(const std::string &source, std::string &id) {
+    return 0;
+  } // LocalBackend::getLastMessageId
+
+  // Rows seeded with a msgid only take the ack for it, without one we
+  // can't tell which message an ack is for so any will do.
+  bool LocalBackend::matches_msgack(local_row_t &row, const std::string &msgack) {
+    fieldsType::const_iterator ptr = row.fields.find("msgid");
+    if (ptr == row.fields.end() || !ptr->second.length()) return true;
+    return ptr->second == msgack;
+  } // LocalBackend::matches_msgack
+
+  openframe::DBI::resultSizeType LocalBackend::getMessageDecayId(const std::string &source, const std::string &target,
+                                                                 const std::string &msgack, std::string &id) {
+    time_t last_ts = -1;
+
+    pthread_mutex_lock(&_lock);
+    for(rowsType::iterator ptr = _messages.begin(); ptr != _messages.end(); ptr++) {
+      local_row_t &row = ptr->second;
+      bool ok = row.state == rowStateSent
+                && row.fields["source"] == source
+                && row.fields["target"] == target
+                && matches_msgack(row, msgack)
+                && row.fields["decay_id"].length();
+      if (!ok) continue;
+
+      time_t broadcast_ts = atoi( row.fields["broadcast_ts"].c_str() );
+      if (broadcast_ts < last_ts) continue;
+
+      last_ts = broadcast_ts;
+      id = row.fields["decay_id"];
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return last_ts < 0 ? 0 : 1;
+  } // LocalBackend::getMessageDecayId
+
+  openframe::DBI::resultSizeType LocalBackend::getPendingMessages(StoreResult &res) {
+    init_result(_message_columns, res);
+
+    time_t now = time(NULL);
+    pthread_mutex_lock(&_lock);
+    for(rowsType::iterator ptr = _messages.begin(); ptr != _messages.end();) {
+      if (purge(_messages, ptr, now)) continue;
+
+      if (claim(ptr->second, now)) to_result(ptr->second, _message_columns, res);
+      ptr++;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return res.num_rows();
+  } // LocalBackend::getPendingMessages
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setMessageAck(const std::string &source,
+                                                                   const std::string &target,
+                                                                   const std::string &msgack) {
+    openframe::DBI::simpleResultSizeType ret = 0;
+
+    // ack comes from whoever we sent the message to
+    pthread_mutex_lock(&_lock);
+    for(rowsType::iterator ptr = _messages.begin(); ptr != _messages.end(); ptr++) {
+      local_row_t &row = ptr->second;
+      bool ok = row.state == rowStateSent
+                && row.fields["source"] == target
+                && row.fields["target"] == source
+                && matches_msgack(row, msgack);
+      if (!ok) continue;
+
+      row.state = rowStateDone;
+      row.fields["msgack"] = msgack;
+      ret++;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setMessageAck
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setMessageSent(const int id,
+                                                                    const std::string &decay_id,
+                                                                    const time_t broadcast_ts) {
+    pthread_mutex_lock(&_lock);
+    openframe::DBI::simpleResultSizeType ret = set_state(_messages, id, rowStateSent);
+    if (ret) {
+      _messages[id].fields["decay_id"] = decay_id;
+      _messages[id].fields["broadcast_ts"] = openframe::stringify<time_t>(broadcast_ts);
+    } // if
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setMessageSent
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setMessageError(const int id) {
+    pthread_mutex_lock(&_lock);
+    openframe::DBI::simpleResultSizeType ret = set_state(_messages, id, rowStateError);
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setMessageError
+
+  /*************
+   ** Objects **
+   *************/
+
+  openframe::DBI::resultSizeType LocalBackend::getObjectDecayId(const std::string &name, const time_t start_ts,
+                                                                std::string &id) {
+    openframe::DBI::resultSizeType ret = 0;
+
+    pthread_mutex_lock(&_lock);
+    for(rowsType::iterator ptr = _objects.begin(); ptr != _objects.end(); ptr++) {
+      local_row_t &row = ptr->second;
+      bool ok = row.fields["name"] == name
+                && atoi( row.fields["broadcast_ts"].c_str() ) >= start_ts
+                && row.fields["decay_id"].length();
+      if (!ok) continue;
+
+      id = row.fields["decay_id"];
+      ret = 1;
+      break;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::getObjectDecayId
+
+  openframe::DBI::resultSizeType LocalBackend::getPendingObjects(const time_t now, StoreResult &res) {
+    init_result(_object_columns, res);
+
+    pthread_mutex_lock(&_lock);
+    for(rowsType::iterator ptr = _objects.begin(); ptr != _objects.end();) {
+      if (purge(_objects, ptr, now)) continue;
+
+      local_row_t &row = ptr->second;
+      ptr++;
+
+      time_t expire_ts = atoi( row.fields["expire_ts"].c_str() );
+      if (expire_ts && expire_ts < now && row.state != rowStateClaimed) {
+        row.state = rowStateDone;
+        continue;
+      } // if
+
+      // sent objects come back round once they're due to beacon again
+      if (row.state == rowStateSent) {
+        time_t broadcast_ts = atoi( row.fields["broadcast_ts"].c_str() );
+        time_t beacon = atoi( row.fields["beacon"].c_str() );
+        if (broadcast_ts > now - beacon) continue;
+        row.state = rowStatePending;
+      } // if
+
+      if (claim(row, now)) to_result(row, _object_columns, res);
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return res.num_rows();
+  } // LocalBackend::getPendingObjects
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setObjectSent(const int id,
+                                                                   const std::string &decay_id,
+                                                                   const time_t broadcast_ts) {
+    pthread_mutex_lock(&_lock);
+    openframe::DBI::simpleResultSizeType ret = set_state(_objects, id, rowStateSent);
+    if (ret) {
+      local_row_t &row = _objects[id];
+      row.fields["decay_id"] = decay_id;
+      row.fields["broadcast_ts"] = openframe::stringify<time_t>(broadcast_ts);
+
+      // killed objects only go out the once
+      if (row.fields["kill"] == "Y") row.state = rowStateDone;
+    } // if
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setObjectSent
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setObjectError(const int id) {
+    pthread_mutex_lock(&_lock);
+    openframe::DBI::simpleResultSizeType ret = set_state(_objects, id, rowStateError);
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setObjectError
+
+  /***************
+   ** Positions **
+   ***************/
+
+  openframe::DBI::resultSizeType LocalBackend::getPendingPositions(StoreResult &res) {
+    init_result(_position_columns, res);
+
+    time_t now = time(NULL);
+    pthread_mutex_lock(&_lock);
+    for(rowsType::iterator ptr = _positions.begin(); ptr != _positions.end();) {
+      if (purge(_positions, ptr, now)) continue;
+
+      if (claim(ptr->second, now)) to_result(ptr->second, _position_columns, res);
+      ptr++;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return res.num_rows();
+  } // LocalBackend::getPendingPositions
+
+  // positions are fire and forget, nothing refers back to them
+  openframe::DBI::simpleResultSizeType LocalBackend::setPositionSent(const int id, const time_t broadcast_ts) {
+    pthread_mutex_lock(&_lock);
+    openframe::DBI::simpleResultSizeType ret = _positions.erase(id);
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setPositionSent
+
+  openframe::DBI::simpleResultSizeType LocalBackend::setPositionError(const int id) {
+    pthread_mutex_lock(&_lock);
+    openframe::DBI::simpleResultSizeType ret = set_state(_positions, id, rowStateError);
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // LocalBackend::setPositionError
+} // namespace aprscreate
@@ -0,0 +1,112 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#include "config.h"
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <time.h>
+
+#include <LruCache.h>
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** LruCache Class                                                       **
+ **************************************************************************/
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  LruCache::LruCache(const entriesSizeType max_size) : _max_size(max_size) {
+    _evicted = 0;
+  } // LruCache::LruCache
+
+  LruCache::~LruCache() {
+  } // LruCache::~LruCache
+
+  LruCache::lruResultEnum LruCache::get(const std::string &key, std::string &value) {
+    indexType::iterator ptr = _index.find(key);
+    if (ptr == _index.end()) return lruResultMiss;
+
+    entriesType::iterator entry = ptr->second;
+    if (entry->expire_at <= time(NULL)) {
+      _entries.erase(entry);
+      _index.erase(ptr);
+      return lruResultMiss;
+    } // if
+
+    // bump to the front, splice keeps the iterator valid
+    _entries.splice(_entries.begin(), _entries, entry);
+
+    if (!entry->positive) return lruResultNegative;
+
+    value = entry->value;
+    return lruResultPositive;
+  } // LruCache::get
+
+  void LruCache::put(const std::string &key, const std::string &value, const time_t ttl) {
+    insert(key, value, true, ttl);
+  } // LruCache::put
+
+  void LruCache::put_negative(const std::string &key, const time_t ttl) {
+    insert(key, "", false, ttl);
+  } // LruCache::put_negative
+
+  void LruCache::insert(const std::string &key, const std::string &value, const bool positive, const time_t ttl) {
+    if (!_max_size || ttl <= 0) return;
+
+    erase(key);
+
+    while(_entries.size() >= _max_size) {
+      _index.erase( _entries.back().key );
+      _entries.pop_back();
+      _evicted++;
+    } // while
+
+    lru_entry_t entry;
+    entry.key = key;
+    entry.value = value;
+    entry.positive = positive;
+    entry.expire_at = time(NULL) + ttl;
+
+    _entries.push_front(entry);
+    _index[key] = _entries.begin();
+  } // LruCache::insert
+
+  void LruCache::erase(const std::string &key) {
+    indexType::iterator ptr = _index.find(key);
+    if (ptr == _index.end()) return;
+
+    _entries.erase(ptr->second);
+    _index.erase(ptr);
+  } // LruCache::erase
+
+  void LruCache::clear() {
+    _entries.clear();
+    _index.clear();
+  } // LruCache::clear
+} // namespace aprscreate
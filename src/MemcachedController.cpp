@@ -65,6 +65,9 @@ namespace aprscreate {
     memcached_return rc;
 
     _expire = 0;
+    _noreply = false;
+    _pool = NULL;
+    _pool_timeout = 0;
 
     if (!_memcachedServers.length())
       throw MemcachedController_Exception("invalid memcached server list");
@@ -85,13 +88,88 @@ namespace aprscreate {
 
   } // MemcachedController::MemcachedController
 
+  void MemcachedController::init_opts(memcached_opts_t &opts) {
+    opts.binary = false;
+    opts.nodelay = false;
+    opts.ketama = false;
+    opts.noreply = false;
+    opts.connect_timeout = 0;
+    opts.poll_timeout = 0;
+    opts.failure_limit = 0;
+    opts.retry_timeout = 0;
+  } // MemcachedController::init_opts
+
+  MemcachedController &MemcachedController::set_opts(const memcached_opts_t &opts) {
+    if (opts.binary) behavior(MEMCACHED_BEHAVIOR_BINARY_PROTOCOL, 1);
+    if (opts.nodelay) behavior(MEMCACHED_BEHAVIOR_TCP_NODELAY, 1);
+    if (opts.ketama) {
+      behavior(MEMCACHED_BEHAVIOR_DISTRIBUTION, MEMCACHED_DISTRIBUTION_CONSISTENT_KETAMA);
+      behavior(MEMCACHED_BEHAVIOR_KETAMA_WEIGHTED, 1);
+    } // if
+    if (opts.noreply) behavior(MEMCACHED_BEHAVIOR_NOREPLY, 1);
+    if (opts.connect_timeout) behavior(MEMCACHED_BEHAVIOR_CONNECT_TIMEOUT, opts.connect_timeout);
+    if (opts.poll_timeout) behavior(MEMCACHED_BEHAVIOR_POLL_TIMEOUT, opts.poll_timeout);
+    if (opts.failure_limit) {
+      behavior(MEMCACHED_BEHAVIOR_SERVER_FAILURE_LIMIT, opts.failure_limit);
+      behavior(MEMCACHED_BEHAVIOR_REMOVE_FAILED_SERVERS, 1);
+    } // if
+    if (opts.retry_timeout) behavior(MEMCACHED_BEHAVIOR_RETRY_TIMEOUT, opts.retry_timeout);
+
+    _noreply = opts.noreply;
+    return *this;
+  } // MemcachedController::set_opts
+
+  void MemcachedController::behavior(const memcached_behavior_t flag, const uint64_t data) {
+    memcached_return rc = memcached_behavior_set(_st, flag, data);
+    if (rc != MEMCACHED_SUCCESS)
+      throw MemcachedController_Exception("unable to set memcached behavior; "
+        + std::string(memcached_strerror(_st, rc)));
+  } // MemcachedController::behavior
+
+  // Hands out clones of the configured instance so any thread can use
+  // this controller, set_opts() has to come first as the clones copy
+  // the behaviours.  Waits up to timeout ms for a free connection.
+  MemcachedController &MemcachedController::start_pool(const uint32_t initial, const uint32_t max, const time_t timeout) {
+    assert(_pool == NULL);
+
+    _pool = memcached_pool_create(_st, initial, max);
+    if (_pool == NULL)
+      throw MemcachedController_Exception("unable to create memcached pool");
+
+    _pool_timeout = timeout;
+    return *this;
+  } // MemcachedController::start_pool
+
+  memcached_st *MemcachedController::checkout() {
+    if (!_pool) return _st;
+
+    struct timespec ts;
+    ts.tv_sec = _pool_timeout / 1000;
+    ts.tv_nsec = (_pool_timeout % 1000) * 1000000;
+
+    memcached_return rc;
+    memcached_st *st = memcached_pool_fetch(_pool, &ts, &rc);
+    if (st == NULL)
+      throw MemcachedController_Exception("no memcached connection free in pool; "
+        + std::string(memcached_strerror(_st, rc)));
+
+    return st;
+  } // MemcachedController::checkout
+
+  void MemcachedController::checkin(memcached_st *st) {
+    if (!_pool) return;
+    memcached_pool_release(_pool, st);
+  } // MemcachedController::checkin
+
   MemcachedController::~MemcachedController() {
+    if (_pool) memcached_pool_destroy(_pool);
     memcached_server_list_free(_servers);
     memcached_free(_st);
   } // MemcachedController::~MemcachedController
 
   void MemcachedController::flush(const time_t expire) {
-    memcached_flush(_st, expire);
+    MemcachedHandle handle(this);
+    memcached_flush(handle.st(), expire);
   } // MemcachedController::flush
 
   void MemcachedController::put(const std::string &ns, const std::string &key, const std::string &value) {
@@ -104,6 +182,7 @@ namespace aprscreate {
     uint32_t optflags = 0;
 
     assert(_st != NULL);		// bug
+    MemcachedHandle handle(this);
 
     if (cacheKey.length() < 1)
       throw MemcachedController_Exception("memcached namespace and key must not be 0 length");
@@ -111,12 +190,13 @@ namespace aprscreate {
     if (cacheKey.length() > 255)
       throw MemcachedController_Exception("memcached namespace and key must be less than 256 characters");
 
-    rc = memcached_set(_st, cacheKey.c_str(), cacheKey.length(), value.data(), value.size(),
+    rc = memcached_set(handle.st(), cacheKey.c_str(), cacheKey.length(), value.data(), value.size(),
                        expires, optflags);
 
-    if (rc != MEMCACHED_SUCCESS) {
+    // with noreply the set is only queued, nothing comes back to check
+    if (rc != MEMCACHED_SUCCESS && rc != MEMCACHED_BUFFERED) {
       throw MemcachedController_Exception("memcached unable to set; "
-        + std::string(memcached_strerror(_st, rc)));
+        + std::string(memcached_strerror(handle.st(), rc)));
     } // if
 
   } // MemcachedController::put
@@ -131,6 +211,7 @@ namespace aprscreate {
     uint32_t optflags = 0;
 
     assert(_st != NULL);		// bug
+    MemcachedHandle handle(this);
 
     if (cacheKey.length() < 1)
       throw MemcachedController_Exception("memcached namespace and key must not be 0 length");
@@ -138,12 +219,12 @@ namespace aprscreate {
     if (cacheKey.length() > 255)
       throw MemcachedController_Exception("memcached namespace and key must be less than 256 characters");
 
-    rc = memcached_replace(_st, cacheKey.c_str(), cacheKey.length(), value.data(), value.size(),
+    rc = memcached_replace(handle.st(), cacheKey.c_str(), cacheKey.length(), value.data(), value.size(),
                        expires, optflags);
 
-    if (rc != MEMCACHED_SUCCESS) {
+    if (rc != MEMCACHED_SUCCESS && rc != MEMCACHED_BUFFERED) {
       throw MemcachedController_Exception("memcached unable to replace; "
-        + std::string(memcached_strerror(_st, rc)));
+        + std::string(memcached_strerror(handle.st(), rc)));
     } // if
 
   } // MemcachedController::replace
@@ -157,6 +238,7 @@ namespace aprscreate {
     size_t str_length;
 
     assert(_st != NULL);		// bug
+    MemcachedHandle handle(this);
 
     if (cacheKey.length() < 1)
       throw MemcachedController_Exception("memcached namespace and key must not be 0 length");
@@ -164,7 +246,7 @@ namespace aprscreate {
     if (cacheKey.length() > 255)
       throw MemcachedController_Exception("memcached namespace and key must be less than 256 characters");
 
-    str = memcached_get(_st, cacheKey.c_str (), cacheKey.length(), &str_length, &opt_flags, &rc);
+    str = memcached_get(handle.st(), cacheKey.c_str (), cacheKey.length(), &str_length, &opt_flags, &rc);
 
     switch(rc) {
       case MEMCACHED_SUCCESS:
@@ -184,9 +266,81 @@ namespace aprscreate {
 
     if (ret == MEMCACHED_CONTROLLER_ERROR)
       throw MemcachedController_Exception("memcached unable to get; "
-            + std::string(memcached_strerror(_st, rc)));
+            + std::string(memcached_strerror(handle.st(), rc)));
 
     return ret;
   } // MemcachedController::get
 
+  // One round trip for the lot, keys that aren't found are simply left
+  // out of ret.
+  const MemcachedController::valuesType::size_type MemcachedController::get_multi(const std::string &ns,
+                                                                                const keysType &keys,
+                                                                                valuesType &ret) {
+    std::string prefix = ns + ":";
+    std::vector<std::string> cacheKeys;
+    std::vector<const char *> keyPtrs;
+    std::vector<size_t> keyLengths;
+    memcached_return rc;
+
+    assert(_st != NULL);		// bug
+
+    if (keys.empty()) return 0;
+
+    cacheKeys.reserve(keys.size());
+    for(keysType::const_iterator ptr = keys.begin(); ptr != keys.end(); ptr++) {
+      if (ptr->length() < 1)
+        throw MemcachedController_Exception("memcached namespace and key must not be 0 length");
+
+      if (prefix.length() + ptr->length() > 255)
+        throw MemcachedController_Exception("memcached namespace and key must be less than 256 characters");
+
+      cacheKeys.push_back(prefix + *ptr);
+    } // for
+
+    for(std::vector<std::string>::size_type i=0; i < cacheKeys.size(); i++) {
+      keyPtrs.push_back( cacheKeys[i].c_str() );
+      keyLengths.push_back( cacheKeys[i].length() );
+    } // for
+
+    MemcachedHandle handle(this);
+
+    rc = memcached_mget(handle.st(), &keyPtrs[0], &keyLengths[0], keyPtrs.size());
+    if (rc != MEMCACHED_SUCCESS)
+      throw MemcachedController_Exception("memcached unable to mget; "
+            + std::string(memcached_strerror(handle.st(), rc)));
+
+    valuesType::size_type num_found = 0;
+    memcached_result_st *result;
+    while( (result = memcached_fetch_result(handle.st(), NULL, &rc)) != NULL ) {
+      std::string key(memcached_result_key_value(result), memcached_result_key_length(result));
+      if (key.compare(0, prefix.length(), prefix) == 0) {
+        ret[ key.substr(prefix.length()) ] = std::string(memcached_result_value(result),
+                                                         memcached_result_length(result));
+        num_found++;
+      } // if
+      memcached_result_free(result);
+    } // while
+
+    bool ok = rc == MEMCACHED_END
+              || rc == MEMCACHED_SUCCESS
+              || rc == MEMCACHED_NOTFOUND;
+    if (!ok)
+      throw MemcachedController_Exception("memcached unable to fetch; "
+            + std::string(memcached_strerror(handle.st(), rc)));
+
+    return num_found;
+  } // MemcachedController::get_multi
+
+/**************************************************************************
+ ** MemcachedHandle Class                                                **
+ **************************************************************************/
+
+  MemcachedHandle::MemcachedHandle(MemcachedController *controller) : _controller(controller) {
+    _st = _controller->checkout();
+  } // MemcachedHandle::MemcachedHandle
+
+  MemcachedHandle::~MemcachedHandle() {
+    _controller->checkin(_st);
+  } // MemcachedHandle::~MemcachedHandle
+
 } // namespace openaprs
@@ -0,0 +1,433 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <new>
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <openframe/openframe.h>
+#include <stomp/Stomp.h>
+#include <stomp/StompFrame.h>
+#include <stomp/StompHeaders.h>
+
+#include <Publisher.h>
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+/**************************************************************************
+ ** Publisher Class                                                      **
+ **************************************************************************/
+
+  const Publisher::publishesSizeType Publisher::kDefaultFlushSize	= 64;
+  const Publisher::publishesSizeType Publisher::kDefaultMaxQueue	= 65536;
+  const int Publisher::kDefaultLinger				= 5;
+  const int Publisher::kDefaultRetryWait			= 2000;
+  const time_t Publisher::kDefaultConfirmTimeout		= 10;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  Publisher::Publisher(const openframe::LogObject::thread_id_t thread_id,
+                       const std::string &hosts,
+                       const std::string &login,
+                       const std::string &passcode)
+            : openframe::LogObject(thread_id),
+              _hosts(hosts),
+              _login(login),
+              _passcode(passcode) {
+    pthread_mutex_init(&_lock, NULL);
+    pthread_cond_init(&_cond, NULL);
+
+    _stomp = NULL;
+    _flush_size = kDefaultFlushSize;
+    _max_queue = kDefaultMaxQueue;
+    _linger = kDefaultLinger;
+    _window = 0;
+    _next_receipt = 0;
+    _started = false;
+    _done = false;
+
+    memset(&_stats, '\0', sizeof(publisher_stats_t) );
+  } // Publisher::Publisher
+
+  Publisher::~Publisher() {
+    stop();
+
+    if (_stomp) delete _stomp;
+    pthread_cond_destroy(&_cond);
+    pthread_mutex_destroy(&_lock);
+  } // Publisher::~Publisher
+
+  void Publisher::start() {
+    if (_started) return;
+
+    // a broker that's down now is tried again from the loop
+    connect();
+
+    pthread_create(&_thread, NULL, Publisher::PublishThread, this);
+    _started = true;
+
+    TLOG(LogInfo, << "*** Publisher started, flush at "
+                  << _flush_size
+                  << " or " << _linger << "ms"
+                  << ", confirm window " << _window
+                  << std::endl);
+  } // Publisher::start
+
+  // publisher thread only once started
+  bool Publisher::connect() {
+    if (_stomp) return true;
+
+    try {
+      _stomp = new stomp::Stomp(_hosts, _login, _passcode);
+    } // try
+    catch(std::bad_alloc &xa) {
+      assert(false);
+    } // catch
+    catch(stomp::Stomp_Exception &ex) {
+      TLOG(LogWarn, << "ERROR: " << ex.message() << std::endl);
+      return false;
+    } // catch
+
+    return true;
+  } // Publisher::connect
+
+  // whatever can still be sent goes out first
+  void Publisher::stop() {
+    if (!_started) return;
+
+    pthread_mutex_lock(&_lock);
+    _done = true;
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_lock);
+
+    pthread_join(_thread, NULL);
+    _started = false;
+  } // Publisher::stop
+
+  bool Publisher::publish(const std::string &dest, const std::string &body, const tokenType token) {
+    pthread_mutex_lock(&_lock);
+    if (_queue.size() >= _max_queue) {
+      _stats.dropped++;
+      pthread_mutex_unlock(&_lock);
+      return false;
+    } // if
+
+    publish_t p;
+    p.dest = dest;
+    p.body = body;
+    p.token = token;
+    p.sent_at = 0;
+    _queue.push_back(p);
+    _stats.queued++;
+
+    // the first one starts the linger, a full batch cuts it short
+    if (_queue.size() == 1 || _queue.size() >= _flush_size)
+      pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_lock);
+
+    return true;
+  } // Publisher::publish
+
+  Publisher::publishesSizeType Publisher::depth() {
+    pthread_mutex_lock(&_lock);
+    publishesSizeType ret = _queue.size();
+    pthread_mutex_unlock(&_lock);
+    return ret;
+  } // Publisher::depth
+
+  // tokens of everything the broker has confirmed since the last call
+  size_t Publisher::confirmed(tokensType &ret) {
+    pthread_mutex_lock(&_lock);
+    ret.insert(ret.end(), _confirmed.begin(), _confirmed.end());
+    size_t num_confirmed = _confirmed.size();
+    _confirmed.clear();
+    pthread_mutex_unlock(&_lock);
+
+    return num_confirmed;
+  } // Publisher::confirmed
+
+  // counters since the last call, the depth is as of now
+  void Publisher::stats(publisher_stats_t &ret) {
+    pthread_mutex_lock(&_lock);
+    ret = _stats;
+    ret.depth = _queue.size();
+    ret.inflight = __atomic_load_n(&_stats.inflight, __ATOMIC_RELAXED);
+    memset(&_stats, '\0', sizeof(publisher_stats_t) );
+    _stats.inflight = ret.inflight;
+    pthread_mutex_unlock(&_lock);
+  } // Publisher::stats
+
+  /************
+   ** Thread **
+   ************/
+
+  // Sends in order until one fails, returns how many made it.
+  Publisher::publishesSizeType Publisher::flush(const publishesType &batch) {
+    publishesSizeType num_sent = 0;
+    if (!connect()) return 0;
+
+    try {
+      for(publishesType::const_iterator ptr = batch.begin(); ptr != batch.end(); ptr++) {
+        if (!_stomp->send(ptr->dest, ptr->body)) break;
+        num_sent++;
+      } // for
+    } // try
+    catch(stomp::Stomp_Exception &ex) {
+      TLOG(LogWarn, << "ERROR: " << ex.message() << std::endl);
+    } // catch
+
+    return num_sent;
+  } // Publisher::flush
+
+  // needs _lock, returns early on stop()
+  void Publisher::wait(const int ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    } // if
+
+    pthread_cond_timedwait(&_cond, &_lock, &ts);
+  } // Publisher::wait
+
+  void Publisher::loop() {
+    if (_window) {
+      loop_confirmed();
+      return;
+    } // if
+
+    pthread_mutex_lock(&_lock);
+    while(true) {
+      while(!_done && _queue.empty())
+        pthread_cond_wait(&_cond, &_lock);
+
+      // give a partial batch a moment to fill up
+      if (!_done && _linger > 0 && _queue.size() < _flush_size)
+        wait(_linger);
+
+      if (_queue.empty()) {
+        if (_done) break;
+        continue;
+      } // if
+
+      publishesType batch;
+      batch.swap(_queue);
+      pthread_mutex_unlock(&_lock);
+
+      publishesSizeType num_sent = flush(batch);
+
+      pthread_mutex_lock(&_lock);
+      _stats.sent += num_sent;
+      _stats.flushes++;
+      if (num_sent == batch.size()) continue;
+
+      // keep the rest in order ahead of anything queued since
+      _stats.failed++;
+      _queue.insert(_queue.begin(), batch.begin() + num_sent, batch.end());
+      if (_done) {
+        TLOG(LogWarn, << "Publisher dropping "
+                      << _queue.size()
+                      << " unsent on the way out"
+                      << std::endl);
+        _stats.dropped += _queue.size();
+        _queue.clear();
+        break;
+      } // if
+
+      TLOG(LogInfo, << "Publisher send failed, "
+                    << _queue.size()
+                    << " waiting, retry in 2 seconds"
+                    << std::endl);
+      wait(kDefaultRetryWait);
+    } // while
+    pthread_mutex_unlock(&_lock);
+  } // Publisher::loop
+
+  // needs _lock, puts sends back at the front in the order given
+  void Publisher::requeue(publishesType &sends) {
+    _queue.insert(_queue.begin(), sends.begin(), sends.end());
+    sends.clear();
+  } // Publisher::requeue
+
+  size_t Publisher::read_receipts() {
+    tokensType tokens;
+    size_t num_read = 0;
+    stomp::StompFrame *frame;
+
+    while( _stomp->next_frame(frame) ) {
+      if (frame->is_command(stomp::StompFrame::commandReceipt) && frame->is_header("receipt-id")) {
+        unsigned long id = strtoul(frame->get_header("receipt-id").c_str(), NULL, 10);
+        inflightType::iterator ptr = _inflight.find(id);
+        if (ptr != _inflight.end()) {
+          if (ptr->second.token) tokens.push_back(ptr->second.token);
+          _inflight.erase(ptr);
+          num_read++;
+        } // if
+      } // if
+      else if (frame->is_command(stomp::StompFrame::commandError)) {
+        TLOG(LogWarn, << "ERROR: broker said; "
+                      << frame->body()
+                      << std::endl);
+      } // else if
+      frame->release();
+    } // while
+
+    pthread_mutex_lock(&_lock);
+    _confirmed.insert(_confirmed.end(), tokens.begin(), tokens.end());
+    _stats.confirmed += num_read;
+    __atomic_store_n(&_stats.inflight, _inflight.size(), __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&_lock);
+
+    return num_read;
+  } // Publisher::read_receipts
+
+  // Keeps up to _window sends out ahead of their receipts instead of
+  // waiting on each one.  Receipts come back in order so the oldest in
+  // flight is the one that would time out first.
+  void Publisher::loop_confirmed() {
+    while(true) {
+      pthread_mutex_lock(&_lock);
+      while(!_done && _queue.empty() && _inflight.empty())
+        pthread_cond_wait(&_cond, &_lock);
+
+      // what nobody waits on a receipt for still goes out like in loop(),
+      // the rows behind anything else are still pending and get picked
+      // up again on the next run
+      if (_done) {
+        publishesType rest;
+        publishesSizeType num_pending = _inflight.size();
+        for(publishesType::iterator ptr = _queue.begin(); ptr != _queue.end(); ptr++) {
+          if (ptr->token) num_pending++;
+          else rest.push_back(*ptr);
+        } // for
+        _queue.clear();
+        pthread_mutex_unlock(&_lock);
+
+        publishesSizeType num_sent = rest.empty() ? 0 : flush(rest);
+
+        pthread_mutex_lock(&_lock);
+        _stats.sent += num_sent;
+        _stats.dropped += rest.size() - num_sent;
+        pthread_mutex_unlock(&_lock);
+
+        if (num_sent < rest.size() || num_pending) {
+          TLOG(LogWarn, << "Publisher dropping "
+                        << rest.size() - num_sent
+                        << " unsent, "
+                        << num_pending
+                        << " left pending on the way out"
+                        << std::endl);
+        } // if
+        break;
+      } // if
+
+      publishesType batch;
+      while(!_queue.empty() && _inflight.size() + batch.size() < _window) {
+        batch.push_back( _queue.front() );
+        _queue.pop_front();
+      } // while
+      pthread_mutex_unlock(&_lock);
+
+      size_t num_sent = 0;
+      size_t num_read = 0;
+      try {
+        while(!batch.empty() && connect()) {
+          publish_t &p = batch.front();
+          unsigned long id = ++_next_receipt;
+          // handed over the same way the worker hands over its connect
+          // headers, the library has them from here on
+          stomp::StompHeaders *headers = new stomp::StompHeaders("receipt",
+                                                                 openframe::stringify<unsigned long>(id)
+                                                                );
+          if (!_stomp->send(p.dest, p.body, headers)) break;
+
+          p.sent_at = time(NULL);
+          _inflight.insert( std::make_pair(id, p) );
+          batch.pop_front();
+          num_sent++;
+        } // while
+
+        if (_stomp) num_read = read_receipts();
+      } // try
+      catch(stomp::Stomp_Exception &ex) {
+        TLOG(LogWarn, << "ERROR: " << ex.message() << std::endl);
+      } // catch
+
+      bool timed_out = !_inflight.empty()
+                       && _inflight.begin()->second.sent_at < time(NULL) - kDefaultConfirmTimeout;
+
+      pthread_mutex_lock(&_lock);
+      _stats.sent += num_sent;
+      if (num_sent) _stats.flushes++;
+
+      // send failed or the broker went quiet, everything not confirmed
+      // goes out again on the next connection
+      if (!batch.empty() || timed_out) {
+        if (timed_out) _stats.timeouts++;
+        _stats.failed++;
+
+        requeue(batch);
+        publishesType resend;
+        for(inflightType::iterator ptr = _inflight.begin(); ptr != _inflight.end(); ptr++)
+          resend.push_back(ptr->second);
+        _inflight.clear();
+        requeue(resend);
+        __atomic_store_n(&_stats.inflight, 0, __ATOMIC_RELAXED);
+
+        TLOG(LogInfo, << "Publisher "
+                      << (timed_out ? "confirm timed out, " : "send failed, ")
+                      << _queue.size()
+                      << " waiting, retry in 2 seconds"
+                      << std::endl);
+        wait(kDefaultRetryWait);
+      } // if
+      // waiting on receipts, don't spin
+      else if (!num_sent && !num_read)
+        wait(1);
+      pthread_mutex_unlock(&_lock);
+    } // while
+  } // Publisher::loop_confirmed
+
+  void *Publisher::PublishThread(void *arg) {
+    Publisher *publisher = static_cast<Publisher *>(arg);
+    publisher->loop();
+    return NULL;
+  } // Publisher::PublishThread
+} // namespace aprscreate
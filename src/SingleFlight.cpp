@@ -0,0 +1,121 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+
+#include "config.h"
+
+#include <string>
+#include <map>
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <SingleFlight.h>
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** SingleFlight Class                                                   **
+ **************************************************************************/
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  SingleFlight::SingleFlight() {
+    pthread_mutex_init(&_lock, NULL);
+    pthread_cond_init(&_done_cond, NULL);
+  } // SingleFlight::SingleFlight
+
+  SingleFlight::~SingleFlight() {
+    for(flightsType::iterator ptr = _flights.begin(); ptr != _flights.end(); ptr++)
+      delete ptr->second;
+
+    pthread_cond_destroy(&_done_cond);
+    pthread_mutex_destroy(&_lock);
+  } // SingleFlight::~SingleFlight
+
+  // returns true when the caller is the leader and must call finish()
+  bool SingleFlight::join(const std::string &key, flight_t *&flight) {
+    bool leader = false;
+
+    pthread_mutex_lock(&_lock);
+    flightsType::iterator ptr = _flights.find(key);
+    if (ptr == _flights.end()) {
+      flight = new flight_t;
+      flight->key = key;
+      flight->ok = false;
+      flight->done = false;
+      flight->refs = 1;
+      _flights[key] = flight;
+      leader = true;
+    } // if
+    else {
+      flight = ptr->second;
+      flight->refs++;
+    } // else
+    pthread_mutex_unlock(&_lock);
+
+    return leader;
+  } // SingleFlight::join
+
+  void SingleFlight::finish(flight_t *flight, const std::string &value, const bool ok) {
+    pthread_mutex_lock(&_lock);
+    flight->value = value;
+    flight->ok = ok;
+    flight->done = true;
+
+    // later callers start a fresh flight
+    _flights.erase(flight->key);
+    pthread_cond_broadcast(&_done_cond);
+    release(flight);
+    pthread_mutex_unlock(&_lock);
+  } // SingleFlight::finish
+
+  bool SingleFlight::wait(flight_t *flight, std::string &value, const double timeout) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    long usec = now.tv_usec + long((timeout - long(timeout)) * 1000000);
+    struct timespec until;
+    until.tv_sec = now.tv_sec + long(timeout) + usec / 1000000;
+    until.tv_nsec = (usec % 1000000) * 1000;
+
+    pthread_mutex_lock(&_lock);
+    int ret = 0;
+    while(!flight->done && ret == 0)
+      ret = pthread_cond_timedwait(&_done_cond, &_lock, &until);
+
+    // the leader still finishes it, we just don't wait for that
+    bool ok = flight->done && flight->ok;
+    if (ok) value = flight->value;
+    release(flight);
+    pthread_mutex_unlock(&_lock);
+
+    return ok;
+  } // SingleFlight::wait
+
+  // caller holds the lock
+  void SingleFlight::release(flight_t *flight) {
+    if (--flight->refs == 0) delete flight;
+  } // SingleFlight::release
+} // namespace aprscreate
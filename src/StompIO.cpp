@@ -0,0 +1,390 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <new>
+#include <string>
+#include <cassert>
+#include <iostream>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <openframe/openframe.h>
+#include <stomp/Stomp.h>
+#include <stomp/StompFrame.h>
+
+#include <StompIO.h>
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+/**************************************************************************
+ ** StompIO Class                                                        **
+ **************************************************************************/
+
+  const size_t StompIO::kDefaultRingSize		= 2048;
+  const size_t StompIO::kDefaultReadBurst		= 64;
+  const int StompIO::kDefaultIdleWait			= 1;
+  const int StompIO::kDefaultReconnectWait		= 2000;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  StompIO::StompIO(const openframe::LogObject::thread_id_t thread_id,
+                   stomp::Stomp *stomp,
+                   const size_t ring_size)
+          : openframe::LogObject(thread_id),
+            _stomp(stomp),
+            _frames(ring_size),
+            _ops(ring_size) {
+    pthread_mutex_init(&_lock, NULL);
+
+    _held = NULL;
+    _generation = 0;
+    _brokers = NULL;
+    _attempts = 0;
+    _seed = time(NULL) ^ (thread_id << 16);
+    _ready_fd = eventfd(0, EFD_NONBLOCK);
+    _connected = false;
+    _started = false;
+    _done = false;
+
+    _stats.connects = 0;
+    _stats.disconnects = 0;
+    _stats.held = 0;
+    _stats.ops_waited = 0;
+    _stats.retried = 0;
+    _stats.stale_acks = 0;
+  } // StompIO::StompIO
+
+  StompIO::~StompIO() {
+    stop();
+
+    stomp_op_t *op;
+    while( _ops.pop(op) ) delete op;
+    for(opsType::iterator ptr = _retry.begin(); ptr != _retry.end(); ptr++)
+      delete *ptr;
+
+    if (_ready_fd != -1) close(_ready_fd);
+    pthread_mutex_destroy(&_lock);
+  } // StompIO::~StompIO
+
+  StompIO &StompIO::subscribe(const std::string &dest, const std::string &id) {
+    _subscriptions.push_back( std::make_pair(dest, id) );
+    return *this;
+  } // StompIO::subscribe
+
+  void StompIO::start() {
+    if (_started) return;
+
+    pthread_create(&_thread, NULL, StompIO::IOThread, this);
+    _started = true;
+
+    TLOG(LogInfo, << "*** StompIO started, ring size "
+                  << _frames.capacity()
+                  << std::endl);
+  } // StompIO::start
+
+  void StompIO::stop() {
+    if (!_started) return;
+
+    __atomic_store_n(&_done, true, __ATOMIC_RELEASE);
+    pthread_join(_thread, NULL);
+    _started = false;
+
+    // never acked, the broker hands them out again
+    io_frame_t f;
+    while( _frames.pop(f) ) f.frame->release();
+    if (_held) _held->release();
+    _held = NULL;
+
+    TLOG(LogInfo, << "*** StompIO stopped, connects "
+                  << _stats.connects
+                  << ", disconnects " << _stats.disconnects
+                  << ", held " << _stats.held
+                  << ", ops waited " << _stats.ops_waited
+                  << ", retried " << _stats.retried
+                  << ", stale acks " << _stats.stale_acks
+                  << ", unsent " << _retry.size() + _ops.size()
+                  << std::endl);
+  } // StompIO::stop
+
+  /*****************
+   ** Worker Side **
+   *****************/
+
+  bool StompIO::next_frame(stomp::StompFrame *&frame, unsigned int &generation) {
+    io_frame_t f;
+    if ( !_frames.pop(f) ) return false;
+
+    frame = f.frame;
+    generation = f.generation;
+    return true;
+  } // StompIO::next_frame
+
+  // connection the next frame was read on
+  bool StompIO::next_generation(unsigned int &generation) const {
+    io_frame_t f;
+    if ( !_frames.peek(f) ) return false;
+
+    generation = f.generation;
+    return true;
+  } // StompIO::next_generation
+
+  bool StompIO::ack(const std::string &message_id,
+                    const std::string &subscription,
+                    const unsigned int generation) {
+    stomp_op_t *op = new stomp_op_t;
+    op->type = opTypeAck;
+    op->dest = subscription;
+    op->body = message_id;
+    op->generation = generation;
+    op->token = 0;
+    return push_op(op);
+  } // StompIO::ack
+
+  bool StompIO::send(const std::string &dest, const std::string &body, const tokenType token) {
+    stomp_op_t *op = new stomp_op_t;
+    op->type = opTypeSend;
+    op->dest = dest;
+    op->body = body;
+    op->generation = 0;
+    op->token = token;
+    return push_op(op);
+  } // StompIO::send
+
+  // tokens of every send that went out since the last call
+  size_t StompIO::sent(tokensType &ret) {
+    pthread_mutex_lock(&_lock);
+    ret.insert(ret.end(), _sent.begin(), _sent.end());
+    size_t num_sent = _sent.size();
+    _sent.clear();
+    pthread_mutex_unlock(&_lock);
+
+    return num_sent;
+  } // StompIO::sent
+
+  // Acks and sends are never dropped, if the ring is full we wait on the
+  // I/O thread to catch up.
+  bool StompIO::push_op(stomp_op_t *op) {
+    while( !_ops.push(op) ) {
+      if (!_started || __atomic_load_n(&_done, __ATOMIC_ACQUIRE)) {
+        delete op;
+        return false;
+      } // if
+      ++_stats.ops_waited;
+      poll(NULL, 0, kDefaultIdleWait);
+    } // while
+
+    return true;
+  } // StompIO::push_op
+
+  void StompIO::drain_ready() {
+    uint64_t count;
+    ssize_t ret = read(_ready_fd, &count, sizeof(count));
+    (void) ret;
+  } // StompIO::drain_ready
+
+  const std::string StompIO::connected_to() {
+    pthread_mutex_lock(&_lock);
+    std::string ret = _connected_to;
+    pthread_mutex_unlock(&_lock);
+    return ret;
+  } // StompIO::connected_to
+
+  /*************
+   ** Thread **
+   *************/
+
+  bool StompIO::connect() {
+    openframe::Stopwatch sw;
+    sw.Start();
+    bool ok = true;
+    for(subscriptionsType::const_iterator ptr = _subscriptions.begin(); ok && ptr != _subscriptions.end(); ptr++)
+      ok = _stomp->subscribe(ptr->first, ptr->second);
+
+    if (!ok) {
+      TLOG(LogInfo, << "not connected; " << _stomp->last_error() << std::endl);
+      return false;
+    } // if
+
+    pthread_mutex_lock(&_lock);
+    _connected_to = _stomp->connected_to();
+    pthread_mutex_unlock(&_lock);
+
+    ++_stats.connects;
+    ++_generation;
+    _attempts = 0;
+    if (_brokers) _brokers->connected(_stomp->connected_to(), sw.Time() * 1000);
+    __atomic_store_n(&_connected, true, __ATOMIC_RELEASE);
+    TLOG(LogNotice, << "Connected to " << _stomp->connected_to() << std::endl);
+    return true;
+  } // StompIO::connect
+
+  bool StompIO::run() {
+    bool did_work = false;
+    size_t pushed = 0;
+
+    try {
+      did_work = flush_ops() > 0;
+
+      // whatever we read while the ring was full goes first
+      if (_held) {
+        if ( !push_frame(_held) ) return did_work;
+        _held = NULL;
+        ++pushed;
+      } // if
+
+      stomp::StompFrame *frame;
+      while(pushed < kDefaultReadBurst && _stomp->next_frame(frame)) {
+        if ( !push_frame(frame) ) {
+          _held = frame;
+          ++_stats.held;
+          break;
+        } // if
+        ++pushed;
+      } // while
+    } // try
+    catch(stomp::Stomp_Exception &ex) {
+      TLOG(LogWarn, << "ERROR: " << ex.message() << std::endl);
+      __atomic_store_n(&_connected, false, __ATOMIC_RELEASE);
+      ++_stats.disconnects;
+      // it came on the connection we just lost, the broker sends it again
+      if (_held) _held->release();
+      _held = NULL;
+      if (_brokers) _brokers->disconnected( connected_to() );
+      // don't come straight back with everyone else it dropped
+      wait( backoff() );
+      return false;
+    } // catch
+
+    if (pushed) ready();
+    return did_work || pushed;
+  } // StompIO::run
+
+  bool StompIO::push_frame(stomp::StompFrame *frame) {
+    io_frame_t f;
+    f.frame = frame;
+    f.generation = _generation;
+    return _frames.push(f);
+  } // StompIO::push_frame
+
+  // Sends that failed last time go first, in the order they were handed
+  // over.  Whatever throws is kept for the next connection.
+  size_t StompIO::flush_ops() {
+    size_t num_ops = 0;
+
+    while( !_retry.empty() ) {
+      if ( !run_op(_retry.front()) ) return num_ops;
+      delete _retry.front();
+      _retry.pop_front();
+      ++_stats.retried;
+      ++num_ops;
+    } // while
+
+    stomp_op_t *op;
+    while( _ops.pop(op) ) {
+      _retry.push_back(op);
+      if ( !run_op(op) ) return num_ops;
+      _retry.pop_back();
+      delete op;
+      ++num_ops;
+    } // while
+
+    return num_ops;
+  } // StompIO::flush_ops
+
+  // false when it didn't make it out and should be tried again, an ack
+  // for a connection that's gone counts as done
+  bool StompIO::run_op(stomp_op_t *op) {
+    if (op->type == opTypeAck) {
+      if (op->generation != _generation) {
+        ++_stats.stale_acks;
+        return true;
+      } // if
+      _stomp->ack(op->body, op->dest);
+      return true;
+    } // if
+
+    if ( !_stomp->send(op->dest, op->body) ) return false;
+
+    if (op->token) {
+      pthread_mutex_lock(&_lock);
+      _sent.push_back(op->token);
+      pthread_mutex_unlock(&_lock);
+    } // if
+    return true;
+  } // StompIO::run_op
+
+  void StompIO::ready() {
+    if (_ready_fd == -1) return;
+
+    uint64_t one = 1;
+    ssize_t ret = write(_ready_fd, &one, sizeof(one));
+    (void) ret;
+  } // StompIO::ready
+
+  // sleep in short slices so stop() isn't kept waiting
+  void StompIO::wait(const int ms) {
+    for(int waited=0; waited < ms; waited += 100) {
+      if ( __atomic_load_n(&_done, __ATOMIC_ACQUIRE) ) return;
+      poll(NULL, 0, ms - waited < 100 ? ms - waited : 100);
+    } // for
+  } // StompIO::wait
+
+  // ms before the next connect, jittered and growing with brokers
+  int StompIO::backoff() {
+    if (!_brokers) return kDefaultReconnectWait;
+    return _brokers->backoff(_attempts++, _seed);
+  } // StompIO::backoff
+
+  void StompIO::loop() {
+    while( !__atomic_load_n(&_done, __ATOMIC_ACQUIRE) ) {
+      if (!is_connected() && !connect()) {
+        wait( backoff() );
+        continue;
+      } // if
+
+      if (!run()) wait(kDefaultIdleWait);
+    } // while
+
+    // get out whatever the worker queued before it stopped
+    try {
+      if ( is_connected() ) flush_ops();
+    } // try
+    catch(stomp::Stomp_Exception &ex) {
+      TLOG(LogWarn, << "ERROR: " << ex.message() << std::endl);
+    } // catch
+  } // StompIO::loop
+
+  void *StompIO::IOThread(void *arg) {
+    StompIO *io = static_cast<StompIO *>(arg);
+    io->loop();
+    return NULL;
+  } // StompIO::IOThread
+} // namespace aprscreate
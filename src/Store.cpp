@@ -29,6 +29,8 @@
 #include <cassert>
 #include <new>
 #include <iostream>
+#include <algorithm>
+#include <set>
 
 #include <errno.h>
 #include <time.h>
@@ -40,7 +42,12 @@
 #include <openstats/StatsClient_Interface.h>
 
 #include "DBI.h"
+#include "StoreBackend.h"
 #include "MemcachedController.h"
+#include "LruCache.h"
+#include "ConcurrentCache.h"
+#include "SingleFlight.h"
+#include "CircuitBreaker.h"
 #include "Store.h"
 
 namespace aprscreate {
@@ -50,6 +57,14 @@ namespace aprscreate {
  ** Store Class                                                         **
  **************************************************************************/
   const time_t Store::kDefaultReportInterval			= 3600;
+  const double Store::kDefaultDeadline				= 2.0;
+  const time_t Store::kDefaultDeadlineBackoff			= 10;
+  const size_t Store::kDefaultL1Size				= 4096;
+  const time_t Store::kDefaultL1Ttl				= 60;
+  const time_t Store::kDefaultL1NegativeTtl			= 30;
+  const time_t Store::kDefaultAckNegativeTtl			= 2;
+  const unsigned int Store::kDefaultRefreshFraction		= 50;
+  const size_t Store::kDefaultSessionBatchMin			= 2;
 
   Store::Store(const openframe::LogObject::thread_id_t thread_id,
                const std::string &host,
@@ -72,44 +87,98 @@ namespace aprscreate {
     _stats.report_interval = report_interval;
     _stompstats.report_interval = 5;
 
-    _last_cache_fail_at = 0;
+    _last_status = storeStatusOk;
+    _slow_query = DBI::kDefaultSlowQuery;
+
+    _deadline.budget = kDefaultDeadline;
+    _deadline.backoff = kDefaultDeadlineBackoff;
+    _deadline.stalled_until = 0;
+
+    CircuitBreaker::init_opts(_breaker_opts);
+    MemcachedController::init_opts(_memcached_opts);
+
+    _l1_opts.size = kDefaultL1Size;
+    _l1_opts.ttl = kDefaultL1Ttl;
+    _l1_opts.negative_ttl = kDefaultL1NegativeTtl;
 
     _dbi = NULL;
+    _l1 = NULL;
+    _written = NULL;
+    _refresh_fraction = kDefaultRefreshFraction;
+    _memcached_shared = NULL;
+    _breaker = NULL;
+    _shared = NULL;
+    _flights = NULL;
+    _breaker_trips = 0;
+    _backend = NULL;
     _memcached = NULL;
     _profile = NULL;
   } // Store::Store
 
   Store::~Store() {
-    if (_memcached) delete _memcached;
+    if (_memcached && _memcached != _memcached_shared) delete _memcached;
+    if (_l1) delete _l1;
+    if (_written) delete _written;
+    if (_breaker) delete _breaker;
     if (_dbi) delete _dbi;
     if (_profile) delete _profile;
   } // Store::~Store
 
   Store &Store::init() {
-    try {
-      _dbi = new DBI(thread_id(), _host, _user, _pass, _db);
-      _dbi->set_elogger( elogger(), elog_name() );
-      _dbi->init();
-    } // try
-    catch(std::bad_alloc xa) {
-      assert(false);
-    } // catch
+    // no backend handed to us means we talk to MySQL ourselves
+    if (!_backend) {
+      try {
+        _dbi = new DBI(thread_id(), _host, _user, _pass, _db);
+        _dbi->set_elogger( elogger(), elog_name() );
+        _dbi->set_slow_query(_slow_query);
+        _dbi->set_timeout(_deadline.budget);
+        _dbi->init();
+      } // try
+      catch(std::bad_alloc xa) {
+        assert(false);
+      } // catch
+
+      _backend = _dbi;
+    } // if
 
-    _memcached = new MemcachedController(_memcached_host);
-    _memcached->expire(_expire_interval);
+    // memcached is optional, the local backend runs without it
+    if (_memcached_shared) _memcached = _memcached_shared;
+    else if (_memcached_host.length()) {
+      _memcached = new MemcachedController(_memcached_host);
+      _memcached->expire(_expire_interval);
+      _memcached->set_opts(_memcached_opts);
+    } // if
+
+    if (_l1_opts.size) _l1 = new LruCache(_l1_opts.size);
+    // every worker writes the same acks, the markers go where they all
+    // see them and only stay per worker without a shared cache
+    if (_refresh_fraction && !_shared)
+      _written = new LruCache(_l1_opts.size ? _l1_opts.size : kDefaultL1Size);
+
+    _breaker = new CircuitBreaker(thread_id(), "memcached");
+    _breaker->set_elogger( elogger(), elog_name() );
+    _breaker->set_opts(_breaker_opts);
 
     _profile = new openframe::Stopwatch();
     _profile->add("memcached.ack", 300);
 
+    describe_query_stats();
+
     return *this;
   } // Store::init
 
   void Store::init_stats(obj_stats_t &stats, const bool startup) {
     memset(&stats.cache_ack, '\0', sizeof(memcache_stats_t) );
     memset(&stats.cache_session, '\0', sizeof(memcache_stats_t) );
+    memset(&stats.cache_l1, '\0', sizeof(l1_stats_t) );
+    memset(&stats.cache_mget, '\0', sizeof(mget_stats_t) );
 
     memset(&stats.sql_ack, '\0', sizeof(sql_stats_t) );
     memset(&stats.sql_session, '\0', sizeof(sql_stats_t) );
+    memset(&stats.push_session, '\0', sizeof(session_stats_t) );
+    memset(&stats.deadline, '\0', sizeof(deadline_stats_t) );
+    memset(&stats.breaker, '\0', sizeof(breaker_stats_t) );
+    stats.coalesced = 0;
 
     stats.last_report_at = time(NULL);
     if (startup) stats.created_at = time(NULL);
@@ -120,7 +189,23 @@ namespace aprscreate {
     describe_root_stat("store.num.cache.ack.misses", "store/cache/ack/num misses - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_root_stat("store.num.cache.ack.tries", "store/cache/ack/num tries - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_root_stat("store.num.cache.ack.stored", "store/cache/ack/num stored - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.ack.coalesced", "store/cache/ack/num writes avoided - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_root_stat("store.num.cache.ack.hitrate", "store/cache/ack/num hitrate - ack", openstats::graphTypeGauge, openstats::dataTypeFloat);
+    describe_root_stat("store.num.cache.ack.mget.calls", "store/cache/ack/mget/num round trips", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.ack.mget.keys", "store/cache/ack/mget/num keys", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.ack.mget.found", "store/cache/ack/mget/num found", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.ack.mget.batch", "store/cache/ack/mget/num keys per round trip", openstats::graphTypeGauge, openstats::dataTypeFloat);
+
+    describe_root_stat("store.num.cache.breaker.state", "store/cache/breaker/num state", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.breaker.trips", "store/cache/breaker/num trips", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.breaker.rejected", "store/cache/breaker/num rejected", openstats::graphTypeCounter, openstats::dataTypeInt);
+
+    describe_root_stat("store.num.cache.l1.hits", "store/cache/l1/num hits", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.l1.negative", "store/cache/l1/num negative hits", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.l1.misses", "store/cache/l1/num misses", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.l1.tries", "store/cache/l1/num tries", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.cache.l1.hitrate", "store/cache/l1/num hitrate", openstats::graphTypeGauge, openstats::dataTypeFloat);
+    describe_root_stat("store.num.cache.l1.size", "store/cache/l1/num entries", openstats::graphTypeGauge, openstats::dataTypeInt);
 
     describe_root_stat("store.num.sql.ack.hits", "store/sql/ack/num hits - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_root_stat("store.num.sql.ack.misses", "store/sql/ack/num misses - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
@@ -128,8 +213,38 @@ namespace aprscreate {
     describe_root_stat("store.num.sql.ack.inserted", "store/sql/ack/num inserted - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_root_stat("store.num.sql.ack.failed", "store/sql/ack/num failed - ack", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_root_stat("store.num.sql.ack.hitrate", "store/sql/ack/num hitrate - ack", openstats::graphTypeGauge, openstats::dataTypeFloat);
+
+    describe_root_stat("store.num.session.push.started", "store/session/push/num started", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.push.ended", "store/session/push/num ended", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.batches", "store/session/num batch lookups", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.batched", "store/session/num answered by batch", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.preloaded", "store/session/num preloaded", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.sql.tries", "store/session/sql/num tries", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.sql.hits", "store/session/sql/num hits", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.session.sql.misses", "store/session/sql/num misses", openstats::graphTypeCounter, openstats::dataTypeInt);
+
+    describe_root_stat("store.num.coalesced", "store/num coalesced lookups", openstats::graphTypeCounter, openstats::dataTypeInt);
+
+    describe_root_stat("store.num.sql.deadline.timeouts", "store/sql/deadline/num timeouts", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_root_stat("store.num.sql.deadline.failfast", "store/sql/deadline/num failfast", openstats::graphTypeCounter, openstats::dataTypeInt);
   } // Store::onDescribeStats
 
+  void Store::describe_query_stats() {
+    if (!_dbi) return;
+
+    const DBI::queryStatsType &qs = _dbi->query_stats();
+    for(DBI::queryStatsType::const_iterator ptr = qs.begin(); ptr != qs.end(); ptr++) {
+      std::string name = "store.num.sql.query."+ptr->first;
+      std::string desc = "store/sql/query/"+ptr->first;
+      describe_root_stat(name+".calls", desc+"/num calls", openstats::graphTypeCounter, openstats::dataTypeInt);
+      describe_root_stat(name+".errors", desc+"/num errors", openstats::graphTypeCounter, openstats::dataTypeInt);
+      describe_root_stat(name+".slow", desc+"/num slow", openstats::graphTypeCounter, openstats::dataTypeInt);
+      describe_root_stat(name+".avg", desc+"/num avg ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_root_stat(name+".p95", desc+"/num p95 ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_root_stat(name+".max", desc+"/num max ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+    } // for
+  } // Store::describe_query_stats
+
   void Store::onDestroyStats() {
     destroy_stat("store.num.*");
   } // Store::onDestroyStats
@@ -139,12 +254,17 @@ namespace aprscreate {
 
     if (_stats.last_report_at > time(NULL) - _stats.report_interval) return;
 
-    TLOG(LogNotice, << "Memcached{ack} hits "
+    TLOG(LogNotice, << (_memcached ? "Memcached" : "Shared")
+                    << "{ack} hits "
                     << _stats.cache_ack.hits
                     << ", misses "
                     << _stats.cache_ack.misses
                     << ", tries "
                     << _stats.cache_ack.tries
+                    << ", stored "
+                    << _stats.cache_ack.stored
+                    << ", writes avoided "
+                    << _stats.cache_ack.coalesced
                     << ", rate %"
                     << std::fixed << std::setprecision(2)
                     << OPENSTATS_PERCENT(_stats.cache_ack.hits, _stats.cache_ack.tries)
@@ -154,6 +274,47 @@ namespace aprscreate {
                     << "s"
                     << std::endl);
 
+    if (_stats.cache_mget.calls) {
+      TLOG(LogNotice, << "Memcached{mget} round trips "
+                      << _stats.cache_mget.calls
+                      << ", keys "
+                      << _stats.cache_mget.keys
+                      << ", found "
+                      << _stats.cache_mget.found
+                      << ", keys per trip "
+                      << std::fixed << std::setprecision(2)
+                      << OPENSTATS_AVERAGE(_stats.cache_mget.keys, _stats.cache_mget.calls)
+                      << std::endl);
+    } // if
+
+    if (_memcached) {
+      TLOG(LogNotice, << "Memcached{breaker} "
+                      << _breaker->state()
+                      << ", trips "
+                      << _breaker->trips()
+                      << ", rejected "
+                      << _stats.breaker.rejected
+                      << std::endl);
+    } // if
+
+    if (_l1) {
+      TLOG(LogNotice, << "L1 hits "
+                      << _stats.cache_l1.hits
+                      << ", negative "
+                      << _stats.cache_l1.negative
+                      << ", misses "
+                      << _stats.cache_l1.misses
+                      << ", tries "
+                      << _stats.cache_l1.tries
+                      << ", rate %"
+                      << std::fixed << std::setprecision(2)
+                      << OPENSTATS_PERCENT(_stats.cache_l1.hits + _stats.cache_l1.negative, _stats.cache_l1.tries)
+                      << ", entries "
+                      << _l1->size()
+                      << ", evicted "
+                      << _l1->evicted()
+                      << std::endl);
+    } // if
 
     TLOG(LogNotice, << "Sql{ack} hits "
                     << _stats.sql_ack.hits
@@ -166,6 +327,36 @@ namespace aprscreate {
                     << OPENSTATS_PERCENT(_stats.sql_ack.hits, _stats.sql_ack.tries)
                     << std::endl);
 
+    TLOG(LogNotice, << "Session{push} started "
+                    << _stats.push_session.started
+                    << ", ended "
+                    << _stats.push_session.ended
+                    << ", preloaded "
+                    << _stats.push_session.preloaded
+                    << ", batched "
+                    << _stats.push_session.batched
+                    << "; sql tries "
+                    << _stats.sql_session.tries
+                    << ", hits "
+                    << _stats.sql_session.hits
+                    << ", misses "
+                    << _stats.sql_session.misses
+                    << ", coalesced "
+                    << _stats.coalesced
+                    << std::endl);
+
+    report_query_stats();
+
+    TLOG(LogNotice, << "Sql{deadline} timeouts "
+                    << _stats.deadline.timeouts
+                    << ", failfast "
+                    << _stats.deadline.failfast
+                    << ", budget "
+                    << std::fixed << std::setprecision(2)
+                    << _deadline.budget
+                    << "s"
+                    << std::endl);
+
     init_stats(_stats);
   } // Store::try_stats
 
@@ -187,10 +378,131 @@ namespace aprscreate {
     datapoint("store.num.cache.ack.hits", _stompstats.cache_ack.hits);
     datapoint_float("store.num.cache.ack.hitrate", OPENSTATS_PERCENT(_stompstats.cache_ack.hits, _stompstats.cache_ack.tries) );
     datapoint("store.num.cache.ack.stored", _stompstats.cache_ack.stored);
+    datapoint("store.num.cache.ack.coalesced", _stompstats.cache_ack.coalesced);
+    datapoint("store.num.cache.ack.mget.calls", _stompstats.cache_mget.calls);
+    datapoint("store.num.cache.ack.mget.keys", _stompstats.cache_mget.keys);
+    datapoint("store.num.cache.ack.mget.found", _stompstats.cache_mget.found);
+    datapoint_float("store.num.cache.ack.mget.batch", OPENSTATS_AVERAGE(_stompstats.cache_mget.keys, _stompstats.cache_mget.calls) );
+
+    datapoint("store.num.cache.breaker.state", _breaker->state());
+    datapoint("store.num.cache.breaker.trips", _breaker->trips() - _breaker_trips);
+    datapoint("store.num.cache.breaker.rejected", _stompstats.breaker.rejected);
+    _breaker_trips = _breaker->trips();
+
+    datapoint("store.num.cache.l1.tries", _stompstats.cache_l1.tries);
+    datapoint("store.num.cache.l1.hits", _stompstats.cache_l1.hits);
+    datapoint("store.num.cache.l1.negative", _stompstats.cache_l1.negative);
+    datapoint("store.num.cache.l1.misses", _stompstats.cache_l1.misses);
+    datapoint_float("store.num.cache.l1.hitrate", OPENSTATS_PERCENT(_stompstats.cache_l1.hits + _stompstats.cache_l1.negative, _stompstats.cache_l1.tries) );
+    datapoint("store.num.cache.l1.size", _l1 ? _l1->size() : 0);
+
+    datapoint("store.num.session.push.started", _stompstats.push_session.started);
+    datapoint("store.num.session.push.ended", _stompstats.push_session.ended);
+    datapoint("store.num.session.preloaded", _stompstats.push_session.preloaded);
+    datapoint("store.num.session.batches", _stompstats.push_session.batches);
+    datapoint("store.num.session.batched", _stompstats.push_session.batched);
+    datapoint("store.num.session.sql.tries", _stompstats.sql_session.tries);
+    datapoint("store.num.session.sql.hits", _stompstats.sql_session.hits);
+    datapoint("store.num.session.sql.misses", _stompstats.sql_session.misses);
+
+    datapoint("store.num.coalesced", _stompstats.coalesced);
+
+    datapoint("store.num.sql.deadline.timeouts", _stompstats.deadline.timeouts);
+    datapoint("store.num.sql.deadline.failfast", _stompstats.deadline.failfast);
+
+    try_query_stats();
 
     init_stats(_stompstats);
   } // Store::try_stompstats()
 
+  void Store::try_query_stats() {
+    if (!_dbi) return;
+
+    const DBI::queryStatsType &qs = _dbi->query_stats();
+    for(DBI::queryStatsType::const_iterator ptr = qs.begin(); ptr != qs.end(); ptr++) {
+      const DBI::query_stats_t &q = ptr->second;
+      std::string name = "store.num.sql.query."+ptr->first;
+      datapoint(name+".calls", q.calls);
+      datapoint(name+".errors", q.errors);
+      datapoint(name+".slow", q.slow);
+      datapoint_float(name+".avg", OPENSTATS_AVERAGE(q.total, q.calls) * 1000);
+      datapoint_float(name+".p95", DBI::percentile_query_stats(q, 95) * 1000);
+      datapoint_float(name+".max", q.max * 1000);
+
+      DBI::merge_query_stats(_query_report[ptr->first], q);
+    } // for
+
+    _dbi->clear_query_stats();
+  } // Store::try_query_stats
+
+  void Store::report_query_stats() {
+    for(DBI::queryStatsType::iterator ptr = _query_report.begin(); ptr != _query_report.end(); ptr++) {
+      const DBI::query_stats_t &q = ptr->second;
+      if (!q.calls) continue;
+
+      TLOG(LogNotice, << "Sql{"
+                      << ptr->first
+                      << "} calls "
+                      << q.calls
+                      << ", errors "
+                      << q.errors
+                      << ", slow "
+                      << q.slow
+                      << ", avg "
+                      << std::fixed << std::setprecision(2)
+                      << OPENSTATS_AVERAGE(q.total, q.calls) * 1000
+                      << "ms, p95 "
+                      << DBI::percentile_query_stats(q, 95) * 1000
+                      << "ms, max "
+                      << q.max * 1000
+                      << "ms"
+                      << std::endl);
+    } // for
+
+    _query_report.clear();
+  } // Store::report_query_stats
+
+  //
+  // Deadlines
+  //
+  bool Store::begin_call() {
+    if (is_stalled()) {
+      _stats.deadline.failfast++;
+      _stompstats.deadline.failfast++;
+      _last_status = storeStatusTimeout;
+      return false;
+    } // if
+
+    _last_status = storeStatusOk;
+    _deadline.sw.Start();
+    return true;
+  } // Store::begin_call
+
+  // The connection's timeouts bound the call, only one that failed
+  // because of them trips the backoff.  A slow call that came back with
+  // its answer counts as a success.
+  void Store::end_call(const char *name) {
+    if (!_dbi || !_dbi->is_timeout()) return;
+
+    double elapsed = _deadline.sw.Time();
+
+    _stats.deadline.timeouts++;
+    _stompstats.deadline.timeouts++;
+    _last_status = storeStatusTimeout;
+    _deadline.stalled_until = time(NULL) + _deadline.backoff;
+
+    TLOG(LogWarn, << "deadline{"
+                  << name
+                  << "} took "
+                  << int(elapsed*1000)
+                  << "ms and timed out, budget "
+                  << int(_deadline.budget*1000)
+                  << "ms; failing fast for "
+                  << _deadline.backoff
+                  << "s"
+                  << std::endl);
+  } // Store::end_call
+
   //
   // Verification
   //
@@ -201,16 +513,28 @@ namespace aprscreate {
     if (!ok) return verifyStatusInvalidArgs;
 
     // try and detect resends
-    ok = _dbi->getUserMsgChecksum(id, source, key);
+    if (!begin_call()) return verifyStatusTimeout;
+    ok = _backend->getUserMsgChecksum(id, source, key);
+    end_call("getUserMsgChecksum");
+    if (is_timeout()) return verifyStatusTimeout;
     if (ok) return verifyStatusIgnoredResend;
 
-    _dbi->setUserMsgChecksum(id, source, key);
+    if (!begin_call()) return verifyStatusTimeout;
+    _backend->setUserMsgChecksum(id, source, key);
+    end_call("setUserMsgChecksum");
+    if (is_timeout()) return verifyStatusTimeout;
 
-    ok = _dbi->isUserVerified(source);
+    if (!begin_call()) return verifyStatusTimeout;
+    ok = _backend->isUserVerified(source);
+    end_call("isUserVerified");
+    if (is_timeout()) return verifyStatusTimeout;
     if (ok) return verifyStatusAlreadyVerified;
 
-    DBI::resultSizeType num_affected = _dbi->setTryUserVerify(id, source, key);
+    if (!begin_call()) return verifyStatusTimeout;
+    DBI::resultSizeType num_affected = _backend->setTryUserVerify(id, source, key);
+    end_call("setTryUserVerify");
     if (num_affected) return verifyStatusSuccess;
+    if (is_timeout()) return verifyStatusTimeout;
 
     return verifyStatusFail;
   } // Store::tryVerify
@@ -219,26 +543,50 @@ namespace aprscreate {
   // Memcache Acks
   //
   bool Store::getAckFromMemcached(const std::string &target, std::string &ret) {
-    MemcachedController::memcachedReturnEnum mcr;
+    MemcachedController::memcachedReturnEnum mcr = MemcachedController::MEMCACHED_CONTROLLER_NOTFOUND;
     openframe::Stopwatch sw;
 
-    if (!isMemcachedOk()) return false;
-
     std::string key = openframe::StringTool::toUpper(target);
 
+    // nothing here touches sql, don't leave an earlier timeout standing
+    _last_status = storeStatusOk;
+
+    switch( l1_get("ack:"+key, ret) ) {
+      case LruCache::lruResultPositive:
+        return true;
+      case LruCache::lruResultNegative:
+        // a batch lookup just came up empty for this one
+        return false;
+      default:
+        break;
+    } // switch
+
+    // without memcached the process wide cache stands in for it
+    bool use_shared = !_memcached && _shared;
+    if (!use_shared && (!_memcached || !allow_memcached())) return false;
+
     _stats.cache_ack.tries++;
     _stompstats.cache_ack.tries++;
 
     sw.Start();
 
     std::string buf;
-    try {
-      mcr = _memcached->get("ack", key, buf);
-    } // try
-    catch(MemcachedController_Exception e) {
-      TLOG(LogError, << e.message() << std::endl);
-      _last_cache_fail_at = time(NULL);
-    } // catch
+    if (use_shared) {
+      if (_shared->get("ack", key, buf)) mcr = MemcachedController::MEMCACHED_CONTROLLER_SUCCESS;
+    } // if
+    else {
+      bool ok = true;
+      try {
+        mcr = _memcached->get("ack", key, buf);
+      } // try
+      catch(const MemcachedController_Exception &e) {
+        TLOG(LogError, << e.message() << std::endl);
+        ok = false;
+      } // catch
+
+      // a clean miss is still a healthy memcached
+      _breaker->record(ok, sw.Time());
+    } // else
 
     _profile->average("memcached.ack", sw.Time());
 
@@ -252,6 +600,7 @@ namespace aprscreate {
     _stompstats.cache_ack.hits++;
 
     ret = buf;
+    if (_l1) _l1->put("ack:"+key, buf, _l1_opts.ttl);
 
     TLOG(LogDebug, << "memcached{ack} found key "
                    << target
@@ -267,86 +616,443 @@ namespace aprscreate {
   bool Store::setAckInMemcached(const std::string &target, const std::string &buf, const time_t expire) {
     bool isOK = true;
 
-    if (!isMemcachedOk()) return false;
-
     std::string key = openframe::StringTool::toUpper(target);
 
+    if (_l1) _l1->put("ack:"+key, buf, std::min(_l1_opts.ttl, expire));
+
+    // we wrote this same value recently enough that it's still fresh
+    if (is_written(key, buf)) {
+      _stats.cache_ack.coalesced++;
+      _stompstats.cache_ack.coalesced++;
+      return true;
+    } // if
+
+    if (!_memcached && _shared) {
+      _shared->put("ack", key, buf, expire);
+      _stats.cache_ack.stored++;
+      _stompstats.cache_ack.stored++;
+      written(key, buf, expire);
+      return true;
+    } // if
+
+    if (!_memcached || !allow_memcached()) return false;
+
+    openframe::Stopwatch sw;
+    sw.Start();
     try {
       _memcached->put("ack", key, buf, expire);
     } // try
-    catch(MemcachedController_Exception e) {
+    catch(const MemcachedController_Exception &e) {
       TLOG(LogError, << e.message() << std::endl);
-      _last_cache_fail_at = time(NULL);
+      _breaker->record(false, sw.Time());
       return false;
     } // catch
+    _breaker->record(true, sw.Time());
 
     _stats.cache_ack.stored++;
     _stompstats.cache_ack.stored++;
+    written(key, buf, expire);
     return isOK;
   } // Store::setAckInMemcached
 
+  // remember the write until the refresh fraction of its ttl has gone by
+  void Store::written(const std::string &key, const std::string &buf, const time_t expire) {
+    if (!_refresh_fraction) return;
+
+    time_t fresh_for = expire * _refresh_fraction / 100;
+    if (fresh_for <= 0) return;
+
+    if (_shared) _shared->put("written", key, buf, fresh_for);
+    else if (_written) _written->put(key, buf, fresh_for);
+  } // Store::written
+
+  bool Store::is_written(const std::string &key, const std::string &buf) {
+    std::string last;
+    if (_shared) return _refresh_fraction && _shared->get("written", key, last) && last == buf;
+    return _written && _written->get(key, last) == LruCache::lruResultPositive && last == buf;
+  } // Store::is_written
+
+  // Resolves a batch of ack keys in one round trip and leaves the answers
+  // in the L1, the per frame getAckFromMemcached() calls then hit there.
+  // Misses are remembered briefly so they don't go back out one by one.
+  size_t Store::getAcksFromMemcached(const MemcachedController::keysType &targets) {
+    if (!_l1) return 0;
+
+    MemcachedController::keysType keys;
+    std::set<std::string> seen;
+    for(MemcachedController::keysType::const_iterator ptr = targets.begin(); ptr != targets.end(); ptr++) {
+      std::string key = openframe::StringTool::toUpper(*ptr);
+      if (!key.length() || !seen.insert(key).second) continue;
+
+      std::string buf;
+      if (_l1->get("ack:"+key, buf) != LruCache::lruResultMiss) continue;
+      keys.push_back(key);
+    } // for
+
+    if (keys.empty()) return 0;
+
+    bool use_shared = !_memcached && _shared;
+    if (!use_shared && (!_memcached || !allow_memcached())) return 0;
+
+    openframe::Stopwatch sw;
+    sw.Start();
+
+    MemcachedController::valuesType found;
+    if (use_shared) {
+      for(MemcachedController::keysType::iterator ptr = keys.begin(); ptr != keys.end(); ptr++) {
+        std::string buf;
+        if (_shared->get("ack", *ptr, buf)) found[*ptr] = buf;
+      } // for
+    } // if
+    else {
+      bool ok = true;
+      try {
+        _memcached->get_multi("ack", keys, found);
+      } // try
+      catch(const MemcachedController_Exception &e) {
+        TLOG(LogError, << e.message() << std::endl);
+        ok = false;
+      } // catch
+
+      _breaker->record(ok, sw.Time());
+      if (!ok) return 0;
+    } // else
+
+    _stats.cache_mget.calls++;
+    _stompstats.cache_mget.calls++;
+    _stats.cache_mget.keys += keys.size();
+    _stompstats.cache_mget.keys += keys.size();
+    _stats.cache_mget.found += found.size();
+    _stompstats.cache_mget.found += found.size();
+
+    for(MemcachedController::keysType::iterator ptr = keys.begin(); ptr != keys.end(); ptr++) {
+      MemcachedController::valuesType::iterator fptr = found.find(*ptr);
+      if (fptr != found.end()) _l1->put("ack:"+*ptr, fptr->second, _l1_opts.ttl);
+      else _l1->put_negative("ack:"+*ptr, kDefaultAckNegativeTtl);
+    } // for
+
+    return found.size();
+  } // Store::getAcksFromMemcached
+
+  // the ack lookup for target has already come up with something, so
+  // nothing will need its session
+  bool Store::isAckCached(const std::string &target) {
+    if (!_l1) return false;
+
+    std::string buf;
+    return _l1->get("ack:"+openframe::StringTool::toUpper(target), buf) == LruCache::lruResultPositive;
+  } // Store::isAckCached
+
+  bool Store::allow_memcached() {
+    if (_breaker->allow()) return true;
+
+    _stats.breaker.rejected++;
+    _stompstats.breaker.rejected++;
+    return false;
+  } // Store::allow_memcached
+
+  LruCache::lruResultEnum Store::l1_get(const std::string &key, std::string &ret) {
+    if (!_l1) return LruCache::lruResultMiss;
+
+    _stats.cache_l1.tries++;
+    _stompstats.cache_l1.tries++;
+
+    LruCache::lruResultEnum l1r = _l1->get(key, ret);
+    switch(l1r) {
+      case LruCache::lruResultPositive:
+        _stats.cache_l1.hits++;
+        _stompstats.cache_l1.hits++;
+        break;
+      case LruCache::lruResultNegative:
+        _stats.cache_l1.negative++;
+        _stompstats.cache_l1.negative++;
+        break;
+      default:
+        _stats.cache_l1.misses++;
+        _stompstats.cache_l1.misses++;
+        break;
+    } // switch
+
+    return l1r;
+  } // Store::l1_get
+
   bool Store::isUserSession(const std::string &callsign, const time_t start_ts) {
-    return _dbi->isUserSession(callsign, start_ts);
+    // callsigns without a web session are the common case, remember
+    // those too so they stop costing a query on every frame
+    std::string key = "session:"+openframe::StringTool::toUpper(callsign);
+    std::string buf;
+
+    // a cached answer is an answer, whatever the last call came to
+    _last_status = storeStatusOk;
+
+    switch( l1_get(key, buf) ) {
+      case LruCache::lruResultPositive:
+        return true;
+      case LruCache::lruResultNegative:
+        return false;
+      default:
+        break;
+    } // switch
+
+    // someone else is already asking, wait for their answer instead of
+    // piling the same query onto the database
+    SingleFlight::flight_t *flight = NULL;
+    if (_flights && !_flights->join(key, flight)) {
+      _stats.coalesced++;
+      _stompstats.coalesced++;
+
+      // no longer than the leader's own call is allowed
+      if (!_flights->wait(flight, buf, _deadline.budget > 0 ? _deadline.budget : kDefaultDeadline)) {
+        _last_status = storeStatusTimeout;
+        return false;
+      } // if
+
+      _last_status = storeStatusOk;
+      bool ret = buf == "1";
+      if (_l1) {
+        if (ret) _l1->put(key, "1", _l1_opts.ttl);
+        else _l1->put_negative(key, _l1_opts.negative_ttl);
+      } // if
+      return ret;
+    } // if
+
+    if (!begin_call()) {
+      if (flight) _flights->finish(flight, "", false);
+      return false;
+    } // if
+    bool ret;
+    try {
+      ret = _backend->isUserSession(callsign, start_ts);
+    } // try
+    catch(...) {
+      // don't leave anyone waiting on an answer that isn't coming
+      if (flight) _flights->finish(flight, "", false);
+      throw;
+    } // catch
+    end_call("isUserSession");
+
+    if (flight) _flights->finish(flight, ret ? "1" : "0", !is_timeout());
+
+    if (!is_timeout()) {
+      _stats.sql_session.tries++;
+      _stompstats.sql_session.tries++;
+      if (ret) {
+        _stats.sql_session.hits++;
+        _stompstats.sql_session.hits++;
+      } // if
+      else {
+        _stats.sql_session.misses++;
+        _stompstats.sql_session.misses++;
+      } // else
+    } // if
+
+    // a timed out answer isn't an answer
+    if (_l1 && !is_timeout()) {
+      if (ret) _l1->put(key, "1", _l1_opts.ttl);
+      else _l1->put_negative(key, _l1_opts.negative_ttl);
+    } // if
+
+    return ret;
   } // Store::isUserSession
 
+  // Answer the session question for a whole batch of callsigns with one
+  // query instead of one each.  Only whatever isn't already in L1 is looked
+  // for, by name, and it's only worth it with a few of those, otherwise
+  // it's left to isUserSession.  Returns how many were answered.
+  size_t Store::resolveSessions(const std::vector<std::string> &callsigns, const time_t start_ts) {
+    if (!_l1) return 0;
+
+    std::set<std::string> misses;
+    std::vector<std::string> lookups;
+    std::string buf;
+    for(std::vector<std::string>::const_iterator ptr = callsigns.begin(); ptr != callsigns.end(); ptr++) {
+      std::string callsign = openframe::StringTool::toUpper(*ptr);
+      std::string key = "session:"+callsign;
+      if (_l1->get(key, buf) != LruCache::lruResultMiss) continue;
+      if (misses.insert(key).second) lookups.push_back(callsign);
+    } // for
+
+    if (misses.size() < kDefaultSessionBatchMin) return 0;
+    // without the procedure they're asked one at a time as before
+    if (_dbi && _dbi->is_missing("getSessionsFor")) return 0;
+
+    StoreResult res;
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType num_rows = _backend->getSessionsFor(lookups, start_ts, res);
+    end_call("getSessionsFor");
+    // a failed batch says nothing about who's logged in
+    if (is_timeout() || (_dbi && _dbi->is_missing("getSessionsFor"))) return 0;
+
+    size_t num_hits = 0;
+    for(openframe::DBI::resultSizeType i=0; i < num_rows; i++) {
+      if (res[i]["callsign"].is_null()) continue;
+
+      std::string key = "session:"+openframe::StringTool::toUpper( res[i]["callsign"].c_str() );
+      if (!misses.erase(key)) continue;
+      _l1->put(key, "1", _l1_opts.ttl);
+      num_hits++;
+    } // for
+
+    // anyone left over isn't logged in
+    for(std::set<std::string>::const_iterator ptr = misses.begin(); ptr != misses.end(); ptr++)
+      _l1->put_negative(*ptr, _l1_opts.negative_ttl);
+
+    size_t num_resolved = num_hits + misses.size();
+    _stats.sql_session.tries += num_resolved;
+    _stompstats.sql_session.tries += num_resolved;
+    _stats.sql_session.hits += num_hits;
+    _stompstats.sql_session.hits += num_hits;
+    _stats.sql_session.misses += misses.size();
+    _stompstats.sql_session.misses += misses.size();
+    _stats.push_session.batches++;
+    _stompstats.push_session.batches++;
+    _stats.push_session.batched += num_resolved;
+    _stompstats.push_session.batched += num_resolved;
+
+    return num_resolved;
+  } // Store::resolveSessions
+
+  // warm the session cache with everyone already logged in so the ack
+  // path starts out not needing isUserSession, without the procedure
+  // that's left to isUserSession as before
+  size_t Store::preloadSessions(const time_t start_ts, const time_t ttl) {
+    if (!_l1) return 0;
+    if (_dbi && _dbi->is_missing("getActiveSessions")) return 0;
+
+    StoreResult res;
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType num_rows = _backend->getActiveSessions(start_ts, res);
+    end_call("getActiveSessions");
+    if (is_timeout()) return 0;
+
+    size_t num_loaded = 0;
+    for(openframe::DBI::resultSizeType i=0; i < num_rows; i++) {
+      if (res[i]["callsign"].is_null()) continue;
+
+      std::string callsign = openframe::StringTool::toUpper( res[i]["callsign"].c_str() );
+      _l1->put("session:"+callsign, "1", ttl);
+      num_loaded++;
+    } // for
+
+    _stats.push_session.preloaded += num_loaded;
+    _stompstats.push_session.preloaded += num_loaded;
+
+    return num_loaded;
+  } // Store::preloadSessions
+
+  void Store::pushSession(const std::string &callsign, const bool active, const time_t ttl) {
+    if (!_l1) return;
+
+    std::string key = "session:"+openframe::StringTool::toUpper(callsign);
+    if (active) {
+      _l1->put(key, "1", ttl);
+      _stats.push_session.started++;
+      _stompstats.push_session.started++;
+    } // if
+    else {
+      _l1->put_negative(key, ttl);
+      _stats.push_session.ended++;
+      _stompstats.push_session.ended++;
+    } // else
+  } // Store::pushSession
+
   openframe::DBI::resultSizeType Store::getLastMessageId(const std::string &source, std::string &id) {
-    return _dbi->getLastMessageId(source, id);
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType ret = _backend->getLastMessageId(source, id);
+    end_call("getLastMessageId");
+    return ret;
   } // Store::getLastMessageId
 
   openframe::DBI::resultSizeType Store::getMessageDecayId(const std::string &source, const std::string &target,
                                                           const std::string &msgack, std::string &id) {
-    return _dbi->getMessageDecayId(source, target, msgack, id);
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType ret = _backend->getMessageDecayId(source, target, msgack, id);
+    end_call("getMessageDecayId");
+    return ret;
   } // Store::getMessageDecayId
 
   openframe::DBI::resultSizeType Store::getObjectDecayId(const std::string &name, const time_t start_ts,
                                                          std::string &id) {
-    return _dbi->getObjectDecayId(name, start_ts, id);
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType ret = _backend->getObjectDecayId(name, start_ts, id);
+    end_call("getObjectDecayId");
+    return ret;
   } // Store::getObjectDecayId
 
-  openframe::DBI::resultSizeType Store::getPendingMessages(openframe::DBI::resultType &res) {
-    return _dbi->getPendingMessages(res);
+  openframe::DBI::resultSizeType Store::getPendingMessages(StoreResult &res) {
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType ret = _backend->getPendingMessages(res);
+    end_call("getPendingMessages");
+    return ret;
   } // Store::getPendingMessages
 
   openframe::DBI::simpleResultSizeType Store::setMessageAck(const std::string &source,
                                                             const std::string &target,
                                                             const std::string &msgack) {
-    return _dbi->setMessageAck(source, target, msgack);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setMessageAck(source, target, msgack);
+    end_call("setMessageAck");
+    return ret;
   } // Store::setMessageAck
 
   openframe::DBI::simpleResultSizeType Store::setMessageSent(const int id,
                                                              const std::string &decay_id,
                                                              const time_t broadcast_ts) {
-    return _dbi->setMessageSent(id, decay_id, broadcast_ts);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setMessageSent(id, decay_id, broadcast_ts);
+    end_call("setMessageSent");
+    return ret;
   } // Store::setMessageSent
 
   openframe::DBI::simpleResultSizeType Store::setMessageError(const int id) {
-    return _dbi->setMessageError(id);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setMessageError(id);
+    end_call("setMessageError");
+    return ret;
   } // Store::setMessageError
 
-  openframe::DBI::resultSizeType Store::getPendingObjects(const time_t now, openframe::DBI::resultType &res) {
-    return _dbi->getPendingObjects(now, res);
+  openframe::DBI::resultSizeType Store::getPendingObjects(const time_t now, StoreResult &res) {
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType ret = _backend->getPendingObjects(now, res);
+    end_call("getPendingObjects");
+    return ret;
   } // Store::getPendingObjects
 
   openframe::DBI::simpleResultSizeType Store::setObjectSent(const int id,
                                                             const std::string &decay_id,
                                                             const time_t broadcast_ts) {
-    return _dbi->setObjectSent(id, decay_id, broadcast_ts);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setObjectSent(id, decay_id, broadcast_ts);
+    end_call("setObjectSent");
+    return ret;
   } // Store::setObjectSent
 
   openframe::DBI::simpleResultSizeType Store::setObjectError(const int id) {
-    return _dbi->setObjectError(id);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setObjectError(id);
+    end_call("setObjectError");
+    return ret;
   } // Store::setObjectError
 
-  openframe::DBI::resultSizeType Store::getPendingPositions(openframe::DBI::resultType &res) {
-    return _dbi->getPendingPositions(res);
+  openframe::DBI::resultSizeType Store::getPendingPositions(StoreResult &res) {
+    if (!begin_call()) return 0;
+    openframe::DBI::resultSizeType ret = _backend->getPendingPositions(res);
+    end_call("getPendingPositions");
+    return ret;
   } // Store::getPendingPositions
 
   openframe::DBI::simpleResultSizeType Store::setPositionSent(const int id, const time_t broadcast_ts) {
-    return _dbi->setPositionSent(id, broadcast_ts);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setPositionSent(id, broadcast_ts);
+    end_call("setPositionSent");
+    return ret;
   } // Store::setPositionSent
 
   openframe::DBI::simpleResultSizeType Store::setPositionError(const int id) {
-    return _dbi->setPositionError(id);
+    if (!begin_call()) return 0;
+    openframe::DBI::simpleResultSizeType ret = _backend->setPositionError(id);
+    end_call("setPositionError");
+    return ret;
   } // Store::setPositionError
 
   std::ostream &operator<<(std::ostream &ss, const Store::verifyStatusEnum status) {
@@ -366,6 +1072,9 @@ namespace aprscreate {
       case Store::verifyStatusFail:
         ss << "Verification failed, check key and try again.";
         break;
+      case Store::verifyStatusTimeout:
+        ss << "Verification unavailable, try again later.";
+        break;
       default:
         ss << "Unknown error.";
         break;
@@ -0,0 +1,74 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <map>
+#include <vector>
+
+#include <openframe/openframe.h>
+
+#include "StoreBackend.h"
+
+namespace aprscreate {
+
+/**************************************************************************
+ ** StoreRow Class                                                       **
+ **************************************************************************/
+
+  const StoreField &StoreRow::operator[](const char *name) const {
+    static const StoreField null_field;
+
+    StoreResult::size_type i;
+    if (!_result->find_column(name, i) || i >= _fields.size()) return null_field;
+
+    return _fields[i];
+  } // StoreRow::operator[]
+
+/**************************************************************************
+ ** StoreResult Class                                                    **
+ **************************************************************************/
+
+  void StoreResult::add_column(const std::string &name) {
+    size_type i = _columns.size();
+    _columns.insert( std::make_pair(name, i) );
+  } // StoreResult::add_column
+
+  bool StoreResult::find_column(const std::string &name, size_type &i) const {
+    columnsType::const_iterator ptr = _columns.find(name);
+    if (ptr == _columns.end()) return false;
+
+    i = ptr->second;
+    return true;
+  } // StoreResult::find_column
+
+  StoreRow &StoreResult::add_row() {
+    push_back( StoreRow(this) );
+    return back();
+  } // StoreResult::add_row
+
+  void StoreResult::reset() {
+    clear();
+    _columns.clear();
+  } // StoreResult::reset
+} // namespace aprscreate
@@ -0,0 +1,182 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <new>
+#include <string>
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <map>
+
+#include <math.h>
+#include <time.h>
+
+#include <openframe/openframe.h>
+
+#include <Suppress.h>
+
+namespace aprscreate {
+  using namespace openframe::loglevel;
+
+/**************************************************************************
+ ** Suppress Class                                                       **
+ **************************************************************************/
+
+  const double Suppress::kDefaultDistance		= 50.0;
+  const int Suppress::kDefaultCourse			= 15;
+  const double Suppress::kDefaultSpeed			= 5.0;
+  const time_t Suppress::kDefaultInterval		= 1800;
+
+  /******************************
+   ** Constructor / Destructor **
+   ******************************/
+
+  Suppress::Suppress(const openframe::LogObject::thread_id_t thread_id)
+           : openframe::LogObject(thread_id),
+             _distance(kDefaultDistance),
+             _course(kDefaultCourse),
+             _speed(kDefaultSpeed),
+             _interval(kDefaultInterval) {
+    pthread_mutex_init(&_lock, NULL);
+  } // Suppress::Suppress
+
+  Suppress::~Suppress() {
+    clear();
+    pthread_mutex_destroy(&_lock);
+  } // Suppress::~Suppress
+
+  /**********************
+   ** Suppress Members **
+   **********************/
+
+  const bool Suppress::is_suppressed(const SuppressMe &p) {
+    pthread_mutex_lock(&_lock);
+    suppressMapType::iterator ptr = _suppressMap.find(p.source);
+    if (ptr == _suppressMap.end()) {
+      pthread_mutex_unlock(&_lock);
+      return false;
+    } // if
+
+    // a copy, another worker may update it as soon as we let go
+    SuppressMe last = *ptr->second;
+    pthread_mutex_unlock(&_lock);
+
+    // been quiet for too long, send it anyway
+    if (last.broadcast_ts < time(NULL) - _interval) return false;
+
+    if (last.symbol_table != p.symbol_table
+        || last.symbol_code != p.symbol_code)
+      return false;
+
+    if (last.status != p.status) return false;
+
+    if (fabs(last.speed - p.speed) > _speed) return false;
+
+    int course = abs(last.course - p.course) % 360;
+    if (course > 180) course = 360 - course;
+    if (course > _course) return false;
+
+    double moved = distance(last.latitude, last.longitude, p.latitude, p.longitude);
+    if (moved > _distance) return false;
+
+    TLOG(LogDebug, << "suppress{position}: "
+                   << p.source
+                   << " moved "
+                   << std::fixed << std::setprecision(1)
+                   << moved
+                   << "m since last broadcast "
+                   << (time(NULL) - last.broadcast_ts)
+                   << "s ago"
+                   << std::endl);
+
+    return true;
+  } // Suppress::is_suppressed
+
+  void Suppress::update(const SuppressMe &p) {
+    pthread_mutex_lock(&_lock);
+    suppressMapType::iterator ptr = _suppressMap.find(p.source);
+    if (ptr != _suppressMap.end()) *ptr->second = p;
+    else _suppressMap.insert( std::make_pair(p.source, new SuppressMe(p)) );
+    pthread_mutex_unlock(&_lock);
+  } // Suppress::update
+
+  const Suppress::suppressMapSizeType Suppress::expire() {
+    time_t now = time(NULL);
+    suppressMapSizeType i = 0;
+
+    pthread_mutex_lock(&_lock);
+    // anything quieter than the interval is going to be sent
+    // regardless so there is no reason to keep it around
+    for(suppressMapType::iterator ptr = _suppressMap.begin(); ptr != _suppressMap.end();) {
+      if (ptr->second->broadcast_ts < now - _interval) {
+        delete ptr->second;
+        _suppressMap.erase(ptr++);
+        i++;
+        continue;
+      } // if
+      ptr++;
+    } // for
+    pthread_mutex_unlock(&_lock);
+
+    return i;
+  } // Suppress::expire
+
+  const Suppress::suppressMapSizeType Suppress::size() {
+    pthread_mutex_lock(&_lock);
+    suppressMapSizeType ret = _suppressMap.size();
+    pthread_mutex_unlock(&_lock);
+    return ret;
+  } // Suppress::size
+
+  const Suppress::suppressMapSizeType Suppress::clear() {
+    pthread_mutex_lock(&_lock);
+    suppressMapSizeType ret = _suppressMap.size();
+
+    for(suppressMapType::iterator ptr = _suppressMap.begin(); ptr != _suppressMap.end(); ptr++)
+      delete ptr->second;
+
+    _suppressMap.clear();
+    pthread_mutex_unlock(&_lock);
+
+    return ret;
+  } // Suppress::clear
+
+  // great circle distance in meters
+  const double Suppress::distance(const double lat1, const double lon1,
+                                  const double lat2, const double lon2) {
+    static const double kEarthRadius = 6371000.0;
+    double rlat1 = lat1 * M_PI / 180.0;
+    double rlat2 = lat2 * M_PI / 180.0;
+    double dlat = (lat2 - lat1) * M_PI / 180.0;
+    double dlon = (lon2 - lon1) * M_PI / 180.0;
+
+    double a = sin(dlat/2) * sin(dlat/2)
+               + cos(rlat1) * cos(rlat2) * sin(dlon/2) * sin(dlon/2);
+
+    return kEarthRadius * 2 * atan2(sqrt(a), sqrt(1-a));
+  } // Suppress::distance
+} // namespace aprscreate
@@ -1,10 +1,16 @@
 #include "config.h"
 
 #include <string>
+#include <map>
+#include <set>
+#include <algorithm>
 
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <poll.h>
+#include <sys/time.h>
 
 #include <openframe/openframe.h>
 #include <stomp/StompHeaders.h>
@@ -13,6 +19,8 @@
 #include <aprs/aprs.h>
 
 #include <Decay.h>
+#include <JobPool.h>
+#include <Suppress.h>
 #include <Worker.h>
 #include <Store.h>
 #include <MemcachedController.h>
@@ -26,11 +34,23 @@ namespace aprscreate {
   const char *Worker::kDefaultStompDestFeedsAprsIs	= "/queue/feeds.aprs.is";
   const char *Worker::kDefaultStompDestPushAprs		= "/queue/push.aprs.is";
   const char *Worker::kDefaultStompDestNotifyMessages	= "/topic/notify.aprs.messages";
+  const char *Worker::kDefaultStompDestNotifySessions	= "/topic/notify.aprs.sessions";
   const char *Worker::kDefaultAprsDest			= "APOA00";
   const time_t Worker::kDefaultDecayRetry		= 15;
   const time_t Worker::kDefaultDecayTimeout		= 900;
   const time_t Worker::kDefaultSessionExpire		= 300;
+  const time_t Worker::kDefaultSessionPushTtl		= 900;
   const char *Worker::kDefaultDigiList			= "TCPIP*,qAC";
+  const size_t Worker::kDefaultCreateThreshold		= 256;
+  const size_t Worker::kDefaultBatchSize		= 64;
+  const int Worker::kDefaultIdleMin			= 1;
+  const int Worker::kDefaultIdleMax			= 100;
+  const int Worker::kDefaultReconnectWait		= 2000;
+  const double Worker::kDefaultFlowTarget		= 0.25;
+  const char *Worker::kDefaultLagHeader			= "timestamp";
+  const double Worker::kDefaultLagWarn			= 30.0;
+  const time_t Worker::kDefaultLagWarnInterval		= 60;
+  const double Worker::kLagBuckets[Worker::kNumLagBuckets]	= { 0.01, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0, 300.0, 0 };
 
 
   Worker::Worker(const openframe::LogObject::thread_id_t thread_id,
@@ -58,7 +78,37 @@ namespace aprscreate {
 
     _store = NULL;
     _stomp = NULL;
+    _io = NULL;
+    _io_generation = 0;
+    _held_generation = 0;
+    _generation = 0;
+    _dispatcher = NULL;
+    _publisher = NULL;
+    _brokers = NULL;
+    _lag.warn = kDefaultLagWarn;
+    _lag.warned_at = 0;
+    _standby = NULL;
+    _stomp_standby = false;
+    _reconnect.attempts = 0;
+    _reconnect.wait = kDefaultReconnectWait;
+    _reconnect.seed = time(NULL) ^ (thread_id << 16);
+    _reconnect.standby_at = 0;
+    _publish_opts.enabled = false;
+    _publish_opts.flush_size = Publisher::kDefaultFlushSize;
+    _publish_opts.linger = Publisher::kDefaultLinger;
+    _publish_opts.max_queue = Publisher::kDefaultMaxQueue;
+    _publish_opts.window = 0;
+    _next_token = 0;
+    _dispatch_shard = 0;
+    _dispatch_reader = false;
     _decay = NULL;
+    _suppress = NULL;
+    _pool = NULL;
+    _store_backend = NULL;
+    _shared_cache = NULL;
+    _single_flight = NULL;
+    _memcached_pool = NULL;
+    _memcached_refresh = Store::kDefaultRefreshFraction;
     _connected = false;
     _console = false;
     _no_send = false;
@@ -66,9 +116,37 @@ namespace aprscreate {
     _stomp_dest_feeds_aprs_is = kDefaultStompDestFeedsAprsIs;
     _stomp_dest_push_aprs = kDefaultStompDestPushAprs;
     _stomp_dest_notify_msgs = kDefaultStompDestNotifyMessages;
+    _stomp_dest_notify_sessions = kDefaultStompDestNotifySessions;
+    _session_push_ttl = kDefaultSessionPushTtl;
+    _session_preload_at = 0;
+    _session_preload_seed = time(NULL) ^ (thread_id << 8);
 
     _create_timer.last_try_at = time(NULL);
     _create_timer.try_interval = 2;
+    _create_threads = 0;
+    _create_threshold = kDefaultCreateThreshold;
+    _batch_size = kDefaultBatchSize;
+    _stomp_prefetch = kDefaultStompPrefetch;
+    _flow.target = kDefaultFlowTarget;
+    _flow.window = kDefaultBatchSize;
+    _flow.pause = 0;
+    _flow.resume = 0;
+    _flow.paused = false;
+    _batch_ack_cumulative = false;
+    _stomp_io = false;
+    _stomp_io_ring = StompIO::kDefaultRingSize;
+    _idle.min = kDefaultIdleMin;
+    _idle.max = kDefaultIdleMax;
+    _idle.wait = kDefaultIdleMin;
+    _sql_deadline = Store::kDefaultDeadline;
+    _sql_deadline_backoff = Store::kDefaultDeadlineBackoff;
+    _sql_slow_query = DBI::kDefaultSlowQuery;
+    _l1_size = Store::kDefaultL1Size;
+    _l1_ttl = Store::kDefaultL1Ttl;
+    _l1_negative_ttl = Store::kDefaultL1NegativeTtl;
+
+    CircuitBreaker::init_opts(_breaker_opts);
+    MemcachedController::init_opts(_memcached_opts);
 
     _callsign = "";
     _digis = kDefaultDigiList;
@@ -82,20 +160,44 @@ namespace aprscreate {
   Worker::~Worker() {
     onDestroyStats();
 
+    // never acked, the broker hands them out again
+    release_frames(_held);
+
+    // get out what's still waiting before the store goes
+    if (_publisher) delete _publisher;
+    // stop reading before the connection goes away
+    if (_io) delete _io;
     if (_store) delete _store;
     if (_stomp) delete _stomp;
+    if (_standby) delete _standby;
+    if (_pool) delete _pool;
   } // Worker:~Worker
 
   void Worker::init() {
     try {
-      stomp::StompHeaders *headers = new stomp::StompHeaders("openstomp.prefetch",
-                                                             openframe::stringify<int>(kDefaultStompPrefetch)
-                                                            );
-      headers->add_header("heart-beat", "0,5000");
-      _stomp = new stomp::Stomp(_stomp_hosts,
-                                _stomp_login,
-                                _stomp_passcode,
-                                headers);
+      std::string hosts = _brokers ? _brokers->hosts() : _stomp_hosts;
+      _stomp = stomp_create(hosts);
+      _stomp_target = hosts.substr(0, hosts.find(','));
+
+      if (_publish_opts.enabled) {
+        _publisher = new Publisher(thread_id(), hosts, _stomp_login, _stomp_passcode);
+        _publisher->set_elogger( elogger(), elog_name() );
+        _publisher->set_flush_size(_publish_opts.flush_size)
+                   .set_linger(_publish_opts.linger)
+                   .set_max_queue(_publish_opts.max_queue)
+                   .set_window(_publish_opts.window);
+        _publisher->start();
+      } // if
+
+      if (_stomp_io) {
+        _io = new StompIO(thread_id(), _stomp, _stomp_io_ring);
+        _io->set_elogger( elogger(), elog_name() );
+        _io->set_brokers(_brokers);
+        if (wants_messages()) _io->subscribe(_stomp_dest_notify_msgs, "1");
+        if (_stomp_dest_notify_sessions.length())
+          _io->subscribe(_stomp_dest_notify_sessions, "2");
+        _io->start();
+      } // if
 
       _store = new Store(thread_id(),
                          _db_host,
@@ -107,10 +209,35 @@ namespace aprscreate {
                          kDefaultStatsInterval);
       _store->replace_stats( stats(), "");
       _store->set_elogger( elogger(), elog_name() );
+      _store->set_backend(_store_backend)
+             .set_shared_cache(_shared_cache)
+             .set_single_flight(_single_flight)
+             .set_breaker_opts(_breaker_opts)
+             .set_memcached_opts(_memcached_opts)
+             .set_memcached(_memcached_pool)
+             .set_refresh_fraction(_memcached_refresh)
+             .set_deadline(_sql_deadline)
+             .set_deadline_backoff(_sql_deadline_backoff)
+             .set_slow_query(_sql_slow_query)
+             .set_l1_size(_l1_size)
+             .set_l1_ttl(_l1_ttl)
+             .set_l1_negative_ttl(_l1_negative_ttl);
       _store->init();
 
+      size_t num_sessions = preload_sessions();
+      TLOG(LogNotice, << "Preloaded "
+                      << num_sessions
+                      << " active sessions"
+                      << std::endl);
+
       _decay = new Decay( thread_id() );
       _decay->set_elogger( elogger(), elog_name() );
+
+      if (_create_threads) {
+        _pool = new JobPool(thread_id(), _create_threads);
+        _pool->set_elogger( elogger(), elog_name() );
+        _pool->start();
+      } // if
     } // try
     catch(std::bad_alloc &xa) {
       assert(false);
@@ -120,9 +247,23 @@ namespace aprscreate {
   void Worker::init_stats(obj_stats_t &stats, const bool startup) {
     stats.connects = 0;
     stats.disconnects = 0;
+    stats.failovers = 0;
     stats.packets = 0;
     stats.frames_in = 0;
     stats.frames_out = 0;
+    stats.batches = 0;
+    stats.waves = 0;
+    stats.dispatched = 0;
+    stats.acks = 0;
+    stats.idles = 0;
+    stats.pauses = 0;
+    stats.shrinks = 0;
+    stats.confirmed = 0;
+    stats.unconfirmed_expired = 0;
+    stats.positions_sent = 0;
+    stats.positions_suppressed = 0;
+    init_lag(stats.lag_receive);
+    init_lag(stats.lag_finish);
 
     stats.last_report_at = time(NULL);
     if (startup) stats.created_at = time(NULL);
@@ -130,16 +271,83 @@ namespace aprscreate {
 
   void Worker::init_stompstats(obj_stompstats_t &stats, const bool startup) {
     memset(&stats.aprs_stats, '\0', sizeof(aprs_stats_t) );
+    stats.batches = 0;
+    stats.batch_frames = 0;
+    stats.dispatched = 0;
+    stats.acks = 0;
+    stats.positions_sent = 0;
+    stats.positions_suppressed = 0;
+    init_lag(stats.lag_receive);
+    init_lag(stats.lag_finish);
 
     stats.last_report_at = time(NULL);
     if (startup) stats.created_at = time(NULL);
   } // Worker::init_stompstats
 
+  void Worker::init_lag(lag_stats_t &lag) {
+    memset(&lag, '\0', sizeof(lag_stats_t) );
+  } // Worker::init_lag
+
+  void Worker::add_lag(lag_stats_t &lag, const double seconds) {
+    unsigned int i;
+    for(i=0; i < kNumLagBuckets-1 && seconds > kLagBuckets[i]; i++);
+    lag.buckets[i]++;
+    lag.frames++;
+    lag.total += seconds;
+    if (seconds > lag.max) lag.max = seconds;
+  } // Worker::add_lag
+
+  // estimate from the buckets, same as the query latencies
+  double Worker::percentile_lag(const lag_stats_t &lag, const double pct) {
+    if (!lag.frames) return 0;
+
+    unsigned int want = (unsigned int) ceil(lag.frames * pct / 100.0);
+    unsigned int seen = 0;
+    for(unsigned int i=0; i < kNumLagBuckets-1; i++) {
+      seen += lag.buckets[i];
+      if (seen >= want) return std::min(kLagBuckets[i], lag.max);
+    } // for
+
+    return lag.max;
+  } // Worker::percentile_lag
+
   void Worker::onDescribeStats() {
     describe_stat("num.frames.out", "worker"+ openframe::stringify<int>( thread_id() ) +"/num frames out", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_stat("num.frames.in", "worker"+ openframe::stringify<int>( thread_id() )+"/num frames in", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_stat("num.bytes.out", "worker"+ openframe::stringify<int>( thread_id() )+"/num bytes out", openstats::graphTypeCounter, openstats::dataTypeInt);
     describe_stat("num.bytes.in", "worker"+ openframe::stringify<int>( thread_id() )+"/num bytes in", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.batches", "worker"+ openframe::stringify<int>( thread_id() )+"/num batches", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.batch.size", "worker"+ openframe::stringify<int>( thread_id() )+"/num batch size", openstats::graphTypeGauge, openstats::dataTypeFloat);
+    describe_stat("num.dispatch.depth", "worker"+ openframe::stringify<int>( thread_id() )+"/num dispatch queue depth", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.dispatch.maxdepth", "worker"+ openframe::stringify<int>( thread_id() )+"/num dispatch queue max depth", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.dispatch.stolen", "worker"+ openframe::stringify<int>( thread_id() )+"/num dispatch stolen", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.dispatch.moved", "worker"+ openframe::stringify<int>( thread_id() )+"/num dispatch keys moved", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.dispatched", "worker"+ openframe::stringify<int>( thread_id() )+"/num dispatched", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.flow.window", "worker"+ openframe::stringify<int>( thread_id() )+"/num flow window", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.flow.paused", "worker"+ openframe::stringify<int>( thread_id() )+"/num flow paused", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.flow.held", "worker"+ openframe::stringify<int>( thread_id() )+"/num flow held", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.publish.depth", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish queue depth", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.publish.sent", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish sent", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.publish.dropped", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish dropped", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.lag.frames", "worker"+ openframe::stringify<int>( thread_id() )+"/num lag frames timed", openstats::graphTypeCounter, openstats::dataTypeInt);
+    const char *lags[] = { "receive", "finish" };
+    for(int i=0; i < 2; i++) {
+      std::string name = std::string("num.lag.") + lags[i];
+      std::string desc = "worker"+ openframe::stringify<int>( thread_id() )+"/lag/" + lags[i];
+      describe_stat(name+".avg", desc+"/num avg ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_stat(name+".p50", desc+"/num p50 ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_stat(name+".p95", desc+"/num p95 ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_stat(name+".p99", desc+"/num p99 ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+      describe_stat(name+".max", desc+"/num max ms", openstats::graphTypeGauge, openstats::dataTypeFloat);
+    } // for
+    describe_stat("num.publish.inflight", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish in flight", openstats::graphTypeGauge, openstats::dataTypeInt);
+    describe_stat("num.publish.confirmed", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish confirmed", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.publish.timeouts", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish confirm timeouts", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.publish.flushes", "worker"+ openframe::stringify<int>( thread_id() )+"/num publish flushes", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.acks.out", "worker"+ openframe::stringify<int>( thread_id() )+"/num acks out", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.positions.sent", "worker"+ openframe::stringify<int>( thread_id() )+"/num positions sent", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.positions.suppressed", "worker"+ openframe::stringify<int>( thread_id() )+"/num positions suppressed", openstats::graphTypeCounter, openstats::dataTypeInt);
+    describe_stat("num.positions.suppressrate", "worker"+ openframe::stringify<int>( thread_id() )+"/num positions suppress rate", openstats::graphTypeGauge, openstats::dataTypeFloat);
   } // Worker::onDescribeStats
 
   void Worker::onDestroyStats() {
@@ -162,18 +370,113 @@ namespace aprscreate {
                     << ", fps in " << fps_in << "/s"
                     << ", frames out " << _stats.frames_out
                     << ", fps out " << fps_out << "/s"
+                    << ", batches " << _stats.batches
+                    << ", waves " << _stats.waves
+                    << ", dispatched " << _stats.dispatched
+                    << ", queued " << (_dispatcher ? _dispatcher->depth(_dispatch_shard) : 0)
+                    << ", publishing " << (_publisher ? _publisher->depth() : 0)
+                    << ", confirmed " << _stats.confirmed
+                    << ", unconfirmed " << _unconfirmed.size()
+                    << ", expired " << _stats.unconfirmed_expired
+                    << ", acks " << _stats.acks
+                    << ", idle waits " << _stats.idles
+                    << ", window " << _flow.window
+                    << ", shrunk " << _stats.shrinks
+                    << ", paused " << _stats.pauses
                     << ", next in " << _stats.report_interval
                     << ", connect attempts " << _stats.connects
-                    << "; " << _stomp->connected_to()
+                    << ", failovers " << _stats.failovers
+                    << "; " << stomp_connected_to()
                     << std::endl);
 
+    report_lag("receive", _stats.lag_receive);
+    report_lag("finish", _stats.lag_finish);
+
+    if (_suppress) {
+      unsigned int tries = _stats.positions_sent + _stats.positions_suppressed;
+      TLOG(LogNotice, << "Positions sent " << _stats.positions_sent
+                      << ", suppressed " << _stats.positions_suppressed
+                      << ", rate %"
+                      << std::fixed << std::setprecision(2)
+                      << OPENSTATS_PERCENT(_stats.positions_suppressed, tries)
+                      << ", tracking " << _suppress->size()
+                      << std::endl);
+    } // if
+
     init_stats(_stats);
     _stats.last_report_at = time(NULL);
   } // Worker::try_stats
 
+  void Worker::report_lag(const std::string &name, const lag_stats_t &lag) {
+    if (!lag.frames) return;
+
+    TLOG(LogNotice, << "Lag{"
+                    << name
+                    << "} frames "
+                    << lag.frames
+                    << ", avg "
+                    << std::fixed << std::setprecision(2)
+                    << OPENSTATS_AVERAGE(lag.total, lag.frames) * 1000
+                    << "ms, p50 "
+                    << percentile_lag(lag, 50) * 1000
+                    << "ms, p95 "
+                    << percentile_lag(lag, 95) * 1000
+                    << "ms, p99 "
+                    << percentile_lag(lag, 99) * 1000
+                    << "ms, max "
+                    << lag.max * 1000
+                    << "ms"
+                    << std::endl);
+  } // Worker::report_lag
+
+  void Worker::datapoint_lag(const std::string &name, const lag_stats_t &lag) {
+    datapoint_float(name+".avg", OPENSTATS_AVERAGE(lag.total, lag.frames) * 1000);
+    datapoint_float(name+".p50", percentile_lag(lag, 50) * 1000);
+    datapoint_float(name+".p95", percentile_lag(lag, 95) * 1000);
+    datapoint_float(name+".p99", percentile_lag(lag, 99) * 1000);
+    datapoint_float(name+".max", lag.max * 1000);
+  } // Worker::datapoint_lag
+
   void Worker::try_stompstats() {
     if (_stompstats.last_report_at > time(NULL) - _stompstats.report_interval) return;
 
+    datapoint("num.batches", _stompstats.batches);
+    datapoint_float("num.batch.size", _stompstats.batches ? double(_stompstats.batch_frames) / _stompstats.batches : 0.0);
+    datapoint("num.acks.out", _stompstats.acks);
+    datapoint("num.flow.window", _flow.window);
+    datapoint("num.flow.paused", _flow.paused ? 1 : 0);
+    datapoint("num.flow.held", _held.size());
+    datapoint("num.dispatched", _stompstats.dispatched);
+    datapoint("num.lag.frames", _stompstats.lag_finish.frames);
+    datapoint_lag("num.lag.receive", _stompstats.lag_receive);
+    datapoint_lag("num.lag.finish", _stompstats.lag_finish);
+
+    if (_publisher) {
+      Publisher::publisher_stats_t ps;
+      _publisher->stats(ps);
+      datapoint("num.publish.depth", ps.depth);
+      datapoint("num.publish.sent", ps.sent);
+      datapoint("num.publish.dropped", ps.dropped);
+      datapoint("num.publish.flushes", ps.flushes);
+      datapoint("num.publish.inflight", ps.inflight);
+      datapoint("num.publish.confirmed", ps.confirmed);
+      datapoint("num.publish.timeouts", ps.timeouts);
+    } // if
+
+    if (_dispatcher) {
+      Dispatcher::dispatch_stats_t ds;
+      _dispatcher->stats(_dispatch_shard, ds);
+      datapoint("num.dispatch.depth", ds.depth);
+      datapoint("num.dispatch.maxdepth", ds.max_depth);
+      datapoint("num.dispatch.stolen", ds.stolen);
+      datapoint("num.dispatch.moved", ds.moved);
+    } // if
+
+    unsigned int tries = _stompstats.positions_sent + _stompstats.positions_suppressed;
+    datapoint("num.positions.sent", _stompstats.positions_sent);
+    datapoint("num.positions.suppressed", _stompstats.positions_suppressed);
+    datapoint_float("num.positions.suppressrate", OPENSTATS_PERCENT(_stompstats.positions_suppressed, tries) );
+
     init_stompstats(_stompstats);
   } // Worker::try_stompstats
 
@@ -184,66 +487,525 @@ namespace aprscreate {
     /**********************
      ** Check Connection **
      **********************/
-    if (!_connected) {
-      ++_stats.connects;
-      bool ok = _stomp->subscribe(_stomp_dest_notify_msgs, "1");
-      if (!ok) {
-        TLOG(LogInfo, << "not connected, retry in 2 seconds; " << _stomp->last_error() << std::endl);
-        return false;
-      } // if
-      _connected = true;
-      TLOG(LogNotice, << "Connected to " << _stomp->connected_to() << std::endl);
-    } // if
-
-    stomp::StompFrame *frame;
-    bool ok = false;
+    if (!stomp_connect()) return false;
 
     if (_create_timer.last_try_at < time(NULL) - _create_timer.try_interval) {
       handle_decays();
+      if (_suppress) _suppress->expire();
       create_messages();
       create_objects();
       create_positions();
       _create_timer.last_try_at = time(NULL);
     } // if
 
+    if (_session_preload_at <= time(NULL)) preload_sessions();
+
+    confirm_sent();
+
+    framesType frames;
+    bool paused = is_paused();
     try {
-      ok = _stomp->next_frame(frame);
+      ack_finished();
+      if (!paused) resume_frames(frames);
+      drain_frames(frames);
+      if (paused) hold_frames(frames);
     } // try
     catch(stomp::Stomp_Exception &ex) {
       TLOG(LogWarn, << "ERROR: " << ex.message() << std::endl);
-      _connected = false;
-      ++_stats.disconnects;
+      // never acked, the broker will hand them out again
+      release_frames(frames);
+      release_frames(_held);
+      stomp_dropped();
       return false;
     } // catch
 
-    if (!ok) return false;
+    Dispatcher::entriesType entries;
+    if (_dispatcher) {
+      _dispatcher->pop(_dispatch_shard, entries, _flow.window);
+      // nothing of our own, help whoever is furthest behind
+      if (frames.empty() && entries.empty() && _dispatcher->steal(_dispatch_shard))
+        _dispatcher->pop(_dispatch_shard, entries, _flow.window);
+    } // if
+
+    if (frames.empty() && entries.empty()) return false;
+
+    _idle.wait = _idle.min;
+    size_t num_frames = std::max(frames.size(), entries.size());
+    openframe::Stopwatch sw;
+    sw.Start();
+    process_frames(frames, entries);
+    release_frames(frames);
+    adjust_flow(num_frames, sw.Time());
+
+    // the reader acks them from here on
+    if (!entries.empty()) _dispatcher->done(_dispatch_shard, entries);
+    return true;
+  } // Worker::run
+
+  // Acks for the frames their owners are done with, only the reader has
+  // the connection they came in on.  Any from a connection that's gone
+  // are dropped, the broker has already handed those out again.
+  size_t Worker::ack_finished() {
+    if (!_dispatcher || !_dispatch_reader) return 0;
+
+    Dispatcher::acksType acks;
+    if (!_dispatcher->finished(acks)) return 0;
+
+    for(Dispatcher::acksType::const_iterator ptr = acks.begin(); ptr != acks.end(); ptr++) {
+      if (_io) _io->ack(ptr->message_id, ptr->subscription, ptr->generation);
+      else if (ptr->generation == _generation) _stomp->ack(ptr->message_id, ptr->subscription);
+      else continue;
+
+      ++_stats.acks;
+      ++_stompstats.acks;
+    } // for
+
+    return acks.size();
+  } // Worker::ack_finished
+
+  // Wait for run() to have something to do again.  The stomp library
+  // doesn't hand out its socket, so this is a timed wait that doubles while
+  // nothing arrives, never runs past the next create pass and returns at
+  // once when wake_fd becomes readable on shutdown or, with an I/O thread,
+  // as soon as it hands over frames.
+  void Worker::idle(const int wake_fd) {
+    int timeout = _io ? kDefaultReconnectWait : _reconnect.wait;
+
+    if (_connected) {
+      timeout = _idle.wait;
+      _idle.wait = std::min(_idle.wait * 2, std::max(_idle.max, _idle.min));
+
+      // creates only run from run() while connected
+      time_t due = _create_timer.last_try_at + _create_timer.try_interval + 1 - time(NULL);
+      if (due <= 0) return;
+      if (due * 1000 < timeout) timeout = due * 1000;
+    } // if
+
+    ++_stats.idles;
+
+    // poll skips negative fds so either may be missing
+    struct pollfd pfds[4];
+    pfds[0].fd = wake_fd;
+    pfds[1].fd = _io ? _io->ready_fd() : -1;
+    pfds[2].fd = _dispatcher ? _dispatcher->ready_fd(_dispatch_shard) : -1;
+    pfds[3].fd = _dispatcher && _dispatch_reader ? _dispatcher->acks_fd() : -1;
+    for(int i=0; i < 4; i++) {
+      pfds[i].events = POLLIN;
+      pfds[i].revents = 0;
+    } // for
+    poll(pfds, 4, timeout);
+  } // Worker::idle
+
+  // Pull whatever the broker has already delivered, up to a batch.  With
+  // an I/O thread a batch never spans a reconnect so its acks all go to
+  // the connection its frames came in on.
+  size_t Worker::drain_frames(framesType &frames) {
+    stomp::StompFrame *frame;
+
+    if (!_io) {
+      while(frames.size() < _flow.window && _stomp->next_frame(frame))
+        frames.push_back(frame);
+      return frames.size();
+    } // if
+
+    _io->drain_ready();
+
+    // held frames already picked the generation
+    unsigned int generation;
+    if (frames.empty() && !_io->next_generation(_io_generation)) return 0;
+    while(frames.size() < _flow.window
+          && _io->next_generation(generation)
+          && generation == _io_generation
+          && _io->next_frame(frame, generation))
+      frames.push_back(frame);
+
+    return frames.size();
+  } // Worker::drain_frames
+
+  // Frames are run in waves so the lookups for a whole wave go out as one
+  // round trip per backend before any of them is processed.  A wave never
+  // holds two frames from the same station and a session change always
+  // ends one, so every station still sees its frames handled in order.
+  void Worker::process_frames(framesType &frames, Dispatcher::entriesType &entries) {
+    stagedType wave;
+    std::set<std::string> sources;
+    ackIdsType last_ids;
+    std::vector<double> stamps;
+    double received_at = now();
+
+    ++_stats.batches;
+    ++_stompstats.batches;
+    _stompstats.batch_frames += frames.size() + entries.size();
+
+    for(framesType::iterator ptr = frames.begin(); ptr != frames.end(); ptr++) {
+      stomp::StompFrame *frame = *ptr;
+
+      ++_stats.frames_in;
+      bool is_usable = frame->is_command(stomp::StompFrame::commandMessage)
+                       && frame->is_header("message-id");
+      if (!is_usable) continue;
+
+      double ts = 0;
+      frame_timestamp(frame, ts);
+
+      if ( is_session_frame(frame) ) {
+        run_wave(wave, last_ids);
+        sources.clear();
+
+        TLOG(LogDebug, << "received session; "
+                       << frame->body()
+                       << std::endl);
+        process_session( frame->body() );
+        ack_frame(frame, last_ids);
+        if (ts) stamps.push_back(ts);
+        continue;
+      } // if
+
+      // we only read them for everyone else, whichever worker owns the
+      // station hands the ack back through the dispatcher once it's done
+      if (_dispatcher) {
+        openframe::Vars v( frame->body() );
+        Dispatcher::dispatch_ack_t ack;
+        ack.message_id = frame->get_header("message-id");
+        ack.subscription = frame_subscription(frame);
+        ack.generation = _io ? _io_generation : _generation;
+        _dispatcher->push(openframe::StringTool::toUpper( v.get("sr") ), frame->body(), ts, ack);
+        ++_stats.dispatched;
+        ++_stompstats.dispatched;
+        continue;
+      } // if
+
+      stage(frame->body(), frame, wave, sources, last_ids);
+      if (ts) stamps.push_back(ts);
+    } // for
+
+    for(Dispatcher::entriesType::const_iterator ptr = entries.begin(); ptr != entries.end(); ptr++) {
+      stage(ptr->body, NULL, wave, sources, last_ids);
+      if (ptr->timestamp) stamps.push_back(ptr->timestamp);
+    } // for
+
+    run_wave(wave, last_ids);
+    if (!stamps.empty()) record_lag(stamps, received_at, now() );
+
+    // in ack:client mode the last ack covers everything before it
+    for(ackIdsType::iterator ptr = last_ids.begin(); ptr != last_ids.end(); ptr++) {
+      stomp_ack(ptr->second, ptr->first);
+      ++_stats.acks;
+      ++_stompstats.acks;
+    } // for
+  } // Worker::process_frames
+
+  double Worker::now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + double(tv.tv_usec) / 1000000;
+  } // Worker::now
+
+  // When the producer sent the frame, the broker's or the producer's
+  // timestamp header in ms or seconds since the epoch.
+  bool Worker::frame_timestamp(stomp::StompFrame *frame, double &ts) {
+    if (!frame->is_header(kDefaultLagHeader)) return false;
+
+    double value = atof( frame->get_header(kDefaultLagHeader).c_str() );
+    if (value <= 0) return false;
+
+    // anything past 5138 AD in seconds is ms
+    ts = value > 1e11 ? value / 1000 : value;
+    return true;
+  } // Worker::frame_timestamp
+
+  // Lag to when we picked the frames up and to when we were done with
+  // them, the difference is our own time on them.  Frames the fan out
+  // reader hands on are counted by whoever works them, from the reader's
+  // timestamp.
+  void Worker::record_lag(const std::vector<double> &stamps, const double received_at, const double finished_at) {
+    double worst = 0;
+    for(std::vector<double>::const_iterator ptr = stamps.begin(); ptr != stamps.end(); ptr++) {
+      // clocks drift, a frame from the future is on time
+      double receive = std::max(received_at - *ptr, 0.0);
+      double finish = std::max(finished_at - *ptr, 0.0);
+      add_lag(_stats.lag_receive, receive);
+      add_lag(_stats.lag_finish, finish);
+      add_lag(_stompstats.lag_receive, receive);
+      add_lag(_stompstats.lag_finish, finish);
+      if (finish > worst) worst = finish;
+    } // for
+
+    if (!_lag.warn || worst < _lag.warn) return;
+    if (_lag.warned_at > time(NULL) - kDefaultLagWarnInterval) return;
+
+    TLOG(LogWarn, << "Lagging "
+                  << std::fixed << std::setprecision(2)
+                  << worst
+                  << "s behind, over the "
+                  << _lag.warn
+                  << "s warning; "
+                  << stamps.size() << " frames, "
+                  << finished_at - received_at << "s to work them"
+                  << ", queued " << (_dispatcher ? _dispatcher->depth(_dispatch_shard) : 0)
+                  << std::endl);
+    _lag.warned_at = time(NULL);
+  } // Worker::record_lag
+
+  void Worker::stage(const std::string &body,
+                     stomp::StompFrame *frame,
+                     stagedType &wave,
+                     std::set<std::string> &sources,
+                     ackIdsType &last_ids) {
+    staged_frame_t sf;
+    sf.frame = frame;
+    sf.body = body;
+    openframe::Vars v(body);
+    sf.is_message = v.is("sr,to,ms,pa");
+    sf.source = v.get("sr");
+    sf.target = v.get("to");
+
+    std::string station = openframe::StringTool::toUpper(sf.source);
+    if (sources.count(station)) {
+      run_wave(wave, last_ids);
+      sources.clear();
+    } // if
+
+    sources.insert(station);
+    wave.push_back(sf);
+  } // Worker::stage
+
+  void Worker::run_wave(stagedType &wave, ackIdsType &last_ids) {
+    if (wave.empty()) return;
+
+    /*******************
+     ** Lookup Stages **
+     *******************/
+    MemcachedController::keysType keys;
+    for(stagedType::const_iterator ptr = wave.begin(); ptr != wave.end(); ptr++)
+      if (ptr->is_message) keys.push_back(ptr->source);
+
+    // ack keys in one multi-get, then the targets of whoever that didn't
+    // find an ack for in one query, both land in L1 for the per frame pass
+    if (keys.size() > 1) _store->getAcksFromMemcached(keys);
+
+    std::vector<std::string> targets;
+    for(stagedType::const_iterator ptr = wave.begin(); ptr != wave.end(); ptr++)
+      if (ptr->is_message && !_store->isAckCached(ptr->source)) targets.push_back(ptr->target);
+    _store->resolveSessions(targets, time(NULL) - _session_expire);
+
+    ++_stats.waves;
 
     /*******************
      ** Process Frame **
      *******************/
-    ++_stats.frames_in;
-    bool is_usable = frame->is_command(stomp::StompFrame::commandMessage)
-                     && frame->is_header("message-id");
-    if (!is_usable) {
-      frame->release();
-      return true;
-    } // if
-    ++_stats.frames_in;
+    for(stagedType::iterator ptr = wave.begin(); ptr != wave.end(); ptr++) {
+      TLOG(LogDebug, << "received message; "
+                     << ptr->body
+                     << std::endl);
 
-   TLOG(LogDebug, << "received message; "
-                  << frame->body()
-                  << std::endl);
+      process_message(ptr->body);
+      if (ptr->frame) ack_frame(ptr->frame, last_ids);
+    } // for
 
-    process_message( frame->body() );
+    wave.clear();
+  } // Worker::run_wave
 
+  void Worker::ack_frame(stomp::StompFrame *frame, ackIdsType &last_ids) {
+    std::string subscription = frame_subscription(frame);
     std::string message_id = frame->get_header("message-id");
-    _stomp->ack(message_id, "1");
+    if (_batch_ack_cumulative) {
+      last_ids[subscription] = message_id;
+      return;
+    } // if
 
-    frame->release();
-    return true;
-  } // Worker::run
+    stomp_ack(message_id, subscription);
+    ++_stats.acks;
+    ++_stompstats.acks;
+  } // Worker::ack_frame
+
+  // Shrink the window by half when a batch runs past the target and grow
+  // it back a quarter at a time while full batches come in well under, so
+  // a slow backend means shorter batches and acks going out sooner.  The
+  // broker's own window can't change on a live subscription, it follows
+  // the next time we connect, see flow_prefetch().
+  void Worker::adjust_flow(const size_t num_frames, const double elapsed) {
+    if (!_flow.target) {
+      _flow.window = _batch_size;
+      return;
+    } // if
 
-  bool Worker::push_aprs(const std::string &body) {
+    if (elapsed > _flow.target && _flow.window > 1) {
+      _flow.window = std::max(_flow.window / 2, size_t(1));
+      ++_stats.shrinks;
+      TLOG(LogDebug, << "flow{shrink} "
+                     << num_frames
+                     << " frames took "
+                     << int(elapsed * 1000)
+                     << "ms, window now "
+                     << _flow.window
+                     << std::endl);
+      return;
+    } // if
+
+    if (num_frames >= _flow.window && elapsed < _flow.target / 2)
+      _flow.window = std::min(_flow.window + std::max(_flow.window / 4, size_t(1)), _batch_size);
+  } // Worker::adjust_flow
+
+  // The prefetch scaled by how far the window has shrunk.  With an I/O
+  // thread the library reconnects with the headers it was built with so
+  // this only applies to the connection we start out with.
+  int Worker::flow_prefetch() const {
+    if (!_flow.target || _flow.window >= _batch_size) return _stomp_prefetch;
+    return std::max(int(_stomp_prefetch * _flow.window / _batch_size), 1);
+  } // Worker::flow_prefetch
+
+  // Only the fan out reader can outrun the workers, everyone else is
+  // already held back by how fast they get through their own frames.
+  bool Worker::is_paused() {
+    if (!_dispatcher || !_dispatch_reader || !_flow.pause) return false;
+
+    size_t depth = 0;
+    for(unsigned int i=0; i < _dispatcher->num_shards(); i++)
+      depth += _dispatcher->depth(i);
+
+    if (!_flow.paused && depth >= _flow.pause) {
+      _flow.paused = true;
+      ++_stats.pauses;
+      TLOG(LogInfo, << "flow{pause} "
+                    << depth
+                    << " messages waiting on workers"
+                    << std::endl);
+    } // if
+    else if (_flow.paused && depth <= _flow.resume) {
+      _flow.paused = false;
+      TLOG(LogInfo, << "flow{resume} "
+                    << depth
+                    << " messages waiting on workers"
+                    << std::endl);
+    } // else if
+
+    return _flow.paused;
+  } // Worker::is_paused
+
+  // While paused the reader keeps reading so the socket, heart-beats and
+  // session frames keep going, but message frames are set aside unacked.
+  // The broker stops sending once the prefetch worth are out, so that is
+  // as many as ever pile up here.
+  void Worker::hold_frames(framesType &frames) {
+    // anything held from a connection that's gone is redelivered anyway
+    if (_io && !_held.empty() && _held_generation != _io_generation) release_frames(_held);
+    _held_generation = _io_generation;
+
+    framesType sessions;
+    for(framesType::iterator ptr = frames.begin(); ptr != frames.end(); ptr++) {
+      if (is_session_frame(*ptr)) sessions.push_back(*ptr);
+      else _held.push_back(*ptr);
+    } // for
+
+    frames.swap(sessions);
+  } // Worker::hold_frames
+
+  // held frames go first once we're reading again
+  void Worker::resume_frames(framesType &frames) {
+    if (_held.empty()) return;
+
+    size_t num_frames = std::min(_held.size(), _flow.window);
+    frames.insert(frames.end(), _held.begin(), _held.begin() + num_frames);
+    _held.erase(_held.begin(), _held.begin() + num_frames);
+    _io_generation = _held_generation;
+  } // Worker::resume_frames
+
+  bool Worker::is_session_frame(stomp::StompFrame *frame) const {
+    return _stomp_dest_notify_sessions.length()
+           && frame->is_header("destination")
+           && frame->get_header("destination") == _stomp_dest_notify_sessions;
+  } // Worker::is_session_frame
+
+  void Worker::release_frames(framesType &frames) {
+    for(framesType::iterator ptr = frames.begin(); ptr != frames.end(); ptr++)
+      (*ptr)->release();
+
+    frames.clear();
+  } // Worker::release_frames
+
+  // With publisher confirms the row is only marked sent once the broker
+  // has the packet, with an I/O thread once it is on the wire.  Whatever
+  // goes with the send, suppress state and decays, is only done once this
+  // says it went out.
+  Worker::pushResultEnum Worker::push_confirmed(const std::string &body,
+                                                const sentTypeEnum type,
+                                                const int id) {
+    bool confirms = _publisher ? _publish_opts.window > 0 : _io != NULL;
+    if (!confirms || _no_send)
+      return push_aprs(body) ? pushResultSent : pushResultDropped;
+
+    Publisher::tokenType token = ++_next_token;
+    if (!push_aprs(body, token)) return pushResultDropped;
+
+    unconfirmed_t u;
+    u.type = type;
+    u.id = id;
+    u.sent_at = time(NULL);
+    _unconfirmed.insert( std::make_pair(token, u) );
+    _unconfirmed_rows[ std::make_pair(type, id) ] = token;
+    return pushResultQueued;
+  } // Worker::push_confirmed
+
+  // the decay only exists once the send went out, it's marked with the row
+  void Worker::set_unconfirmed_decay(const sentTypeEnum type, const int id, const std::string &decay_id) {
+    unconfirmedRowsType::const_iterator ptr = _unconfirmed_rows.find( std::make_pair(type, id) );
+    if (ptr == _unconfirmed_rows.end()) return;
+
+    unconfirmedType::iterator uptr = _unconfirmed.find(ptr->second);
+    if (uptr != _unconfirmed.end()) uptr->second.decay_id = decay_id;
+  } // Worker::set_unconfirmed_decay
+
+  bool Worker::is_unconfirmed(const sentTypeEnum type, const int id) const {
+    return _unconfirmed_rows.count( std::make_pair(type, id) ) > 0;
+  } // Worker::is_unconfirmed
+
+  // Mark everything the broker has confirmed since the last pass as sent,
+  // anything that waited longer than a receipt may goes back to pending.
+  size_t Worker::confirm_sent() {
+    if (_unconfirmed.empty()) return 0;
+
+    Publisher::tokensType tokens;
+    if (_publisher) _publisher->confirmed(tokens);
+    else if (_io) _io->sent(tokens);
+
+    size_t num_confirmed = 0;
+    for(Publisher::tokensType::const_iterator ptr = tokens.begin(); ptr != tokens.end(); ptr++) {
+      unconfirmedType::iterator uptr = _unconfirmed.find(*ptr);
+      if (uptr == _unconfirmed.end()) continue;
+
+      unconfirmed_t &u = uptr->second;
+      switch(u.type) {
+        case sentTypeMessage:
+          _store->setMessageSent(u.id, u.decay_id, u.sent_at);
+          break;
+        case sentTypeObject:
+          _store->setObjectSent(u.id, u.decay_id, u.sent_at);
+          break;
+        case sentTypePosition:
+          _store->setPositionSent(u.id, u.sent_at);
+          break;
+      } // switch
+
+      _unconfirmed_rows.erase( std::make_pair(u.type, u.id) );
+      _unconfirmed.erase(uptr);
+      num_confirmed++;
+    } // for
+
+    // tokens only go up, the oldest is first
+    time_t expire_at = time(NULL) - Publisher::kDefaultConfirmTimeout;
+    while(!_unconfirmed.empty() && _unconfirmed.begin()->second.sent_at < expire_at) {
+      unconfirmed_t &u = _unconfirmed.begin()->second;
+      _unconfirmed_rows.erase( std::make_pair(u.type, u.id) );
+      _unconfirmed.erase( _unconfirmed.begin() );
+      _stats.unconfirmed_expired++;
+    } // while
+
+    _stats.confirmed += num_confirmed;
+    return num_confirmed;
+  } // Worker::confirm_sent
+
+  bool Worker::push_aprs(const std::string &body, const Publisher::tokenType token) {
     if (_no_send) {
       TLOG(LogWarn, << "send{no} "
                     << body
@@ -253,10 +1015,236 @@ namespace aprscreate {
 
     std::stringstream s;
     s << time(NULL) << " " << body << std::endl;
-    _stomp->send(_stomp_dest_feeds_aprs_is, s.str());
-    return _stomp->send(_stomp_dest_push_aprs, body+"\n");
+
+    if (_publisher) {
+      _publisher->publish(_stomp_dest_feeds_aprs_is, s.str());
+      return _publisher->publish(_stomp_dest_push_aprs, body+"\n", token);
+    } // if
+
+    stomp_send(_stomp_dest_feeds_aprs_is, s.str());
+    return stomp_send(_stomp_dest_push_aprs, body+"\n", token);
   } // Worker::push_aprs
 
+  // A standby nobody reads from can't keep up heart-beats, it asks for
+  // none and is checked before it's used instead.
+  stomp::Stomp *Worker::stomp_create(const std::string &hosts, const bool heart_beat) {
+    stomp::StompHeaders *headers = new stomp::StompHeaders("openstomp.prefetch",
+                                                           openframe::stringify<int>( flow_prefetch() )
+                                                          );
+    if (heart_beat) headers->add_header("heart-beat", "0,5000");
+    return new stomp::Stomp(hosts,
+                            _stomp_login,
+                            _stomp_passcode,
+                            headers);
+  } // Worker::stomp_create
+
+  // Replace _stomp with a connection to whatever is best now.  The
+  // constructor connects and throws when it can't, that leaves _stomp
+  // unset and the next stomp_connect() tries again after a backoff.
+  bool Worker::stomp_rebuild() {
+    if (_stomp) delete _stomp;
+    _stomp = NULL;
+
+    std::string hosts = _brokers->hosts();
+    _stomp_target = hosts.substr(0, hosts.find(','));
+    try {
+      _stomp = stomp_create(hosts);
+    } // try
+    catch(stomp::Stomp_Exception &ex) {
+      _brokers->failed(_stomp_target);
+      _reconnect.wait = _brokers->backoff(_reconnect.attempts++, _reconnect.seed);
+      TLOG(LogWarn, << "ERROR: " << _stomp_target
+                    << "; " << ex.message()
+                    << ", retry in " << _reconnect.wait << "ms"
+                    << std::endl);
+      return false;
+    } // catch
+
+    return true;
+  } // Worker::stomp_rebuild
+
+  // With an I/O thread it does the subscribing and we just follow along.
+  bool Worker::stomp_connect() {
+    if (_io) {
+      bool connected = _io->is_connected();
+      if (connected && !_connected) ++_stats.connects;
+      if (!connected && _connected) ++_stats.disconnects;
+      _connected = connected;
+      return _connected;
+    } // if
+
+    if (_connected) {
+      stomp_warm_standby();
+      return true;
+    } // if
+
+    if (!_stomp && !stomp_rebuild()) return false;
+
+    ++_stats.connects;
+    openframe::Stopwatch sw;
+    sw.Start();
+    bool ok = true;
+    std::string error;
+    try {
+      if (wants_messages()) ok = _stomp->subscribe(_stomp_dest_notify_msgs, "1");
+      if (ok && _stomp_dest_notify_sessions.length())
+        ok = _stomp->subscribe(_stomp_dest_notify_sessions, "2");
+      if (!ok) error = _stomp->last_error();
+    } // try
+    catch(stomp::Stomp_Exception &ex) {
+      ok = false;
+      error = ex.message();
+    } // catch
+
+    if (!ok) {
+      _reconnect.wait = _brokers ? _brokers->backoff(_reconnect.attempts++, _reconnect.seed) : kDefaultReconnectWait;
+      TLOG(LogInfo, << "not connected, retry in "
+                    << _reconnect.wait
+                    << "ms; " << error << std::endl);
+
+      // start over with the host we couldn't reach moved to the back
+      if (_brokers) {
+        _brokers->failed(_stomp_target);
+        stomp_rebuild();
+      } // if
+      return false;
+    } // if
+
+    _connected = true;
+    ++_generation;
+    _reconnect.attempts = 0;
+    if (_brokers) _brokers->connected(_stomp->connected_to(), sw.Time() * 1000);
+    TLOG(LogNotice, << "Connected to " << _stomp->connected_to()
+                    << " in " << sw.Time() * 1000 << "ms" << std::endl);
+    return true;
+  } // Worker::stomp_connect
+
+  // Our connection went away, switch to the standby if there is one or
+  // build a new connection to whatever is best now.  A new connection's
+  // first try waits a jittered moment so workers dropped by the same
+  // broker don't all come back at once.
+  void Worker::stomp_dropped() {
+    _connected = false;
+    ++_stats.disconnects;
+    // the I/O thread holds on to _stomp and reconnects it itself
+    if (!_brokers || _io) return;
+
+    std::string host = _stomp ? _stomp->connected_to() : "";
+    _brokers->disconnected(host.length() ? host : _stomp_target);
+
+    // only if it is still up, it's never read so nothing else would notice
+    if (_standby && !_standby->connected_to().length()) {
+      TLOG(LogInfo, << "Standby " << _standby_host << " went away" << std::endl);
+      delete _standby;
+      _standby = NULL;
+    } // if
+
+    if (_standby) {
+      TLOG(LogNotice, << "Failing over to standby " << _standby_host << std::endl);
+      if (_stomp) delete _stomp;
+      _stomp = _standby;
+      _stomp_target = _standby_host;
+      _standby = NULL;
+      _reconnect.wait = 0;
+      _reconnect.standby_at = 0;
+      ++_stats.failovers;
+      return;
+    } // if
+
+    if (stomp_rebuild())
+      _reconnect.wait = _brokers->backoff(_reconnect.attempts++, _reconnect.seed);
+  } // Worker::stomp_dropped
+
+  // Open a connection to the next best broker and leave it unsubscribed
+  // so a drop only costs subscribing again, not connecting from scratch.
+  // Checked every probe interval and opened again once it has gone away.
+  void Worker::stomp_warm_standby() {
+    if (!_stomp_standby || !_brokers || _io) return;
+    if (_reconnect.standby_at > time(NULL)) return;
+    _reconnect.standby_at = time(NULL) + Brokers::kDefaultProbeInterval;
+
+    if (_standby && _standby->connected_to().length()) return;
+    if (_standby) {
+      TLOG(LogInfo, << "Standby " << _standby_host << " went away, reopening" << std::endl);
+      delete _standby;
+      _standby = NULL;
+    } // if
+
+    std::string host = _brokers->standby( _stomp->connected_to() );
+    if (!host.length()) return;
+
+    try {
+      _standby = stomp_create(host, false);
+      _standby_host = host;
+      TLOG(LogInfo, << "Standby connection to " << host << std::endl);
+    } // try
+    catch(stomp::Stomp_Exception &ex) {
+      TLOG(LogWarn, << "ERROR: standby " << host << "; " << ex.message() << std::endl);
+      _standby = NULL;
+    } // catch
+  } // Worker::stomp_warm_standby
+
+  bool Worker::stomp_ack(const std::string &message_id, const std::string &subscription) {
+    if (_io) return _io->ack(message_id, subscription, _io_generation);
+    return _stomp->ack(message_id, subscription);
+  } // Worker::stomp_ack
+
+  // With an I/O thread this only queues it, the token turns up in
+  // confirm_sent() once it is actually out.
+  bool Worker::stomp_send(const std::string &dest, const std::string &body, const Publisher::tokenType token) {
+    if (_io) return _io->send(dest, body, token);
+    return _stomp->send(dest, body);
+  } // Worker::stomp_send
+
+  const std::string Worker::stomp_connected_to() {
+    if (_io) return _io->connected_to();
+    return _stomp ? _stomp->connected_to() : "";
+  } // Worker::stomp_connected_to
+
+  // what we subscribed it under, by destination if the broker didn't say
+  const std::string Worker::frame_subscription(stomp::StompFrame *frame) const {
+    if (frame->is_header("subscription")) return frame->get_header("subscription");
+    return is_session_frame(frame) ? "2" : "1";
+  } // Worker::frame_subscription
+
+  // Sessions only live in L1, loaded from sql again before what we loaded
+  // last times out, so a missed push or an evicted entry is only wrong
+  // until the next load and not for as long as we run.  The next load is
+  // somewhere in the second half of ttl/2 so workers started together
+  // don't all run the same full query at the same moment.
+  size_t Worker::preload_sessions() {
+    time_t interval = std::max(_session_push_ttl / 2, time_t(2));
+    _session_preload_at = time(NULL) + interval / 2 + rand_r(&_session_preload_seed) % (interval / 2 + 1);
+    return _store->preloadSessions(time(NULL) - _session_expire, _session_push_ttl);
+  } // Worker::preload_sessions
+
+  // sessions are pushed as ca:<callsign>|ev:<start|end>
+  bool Worker::process_session(const std::string &body) {
+    openframe::Vars *v = new openframe::Vars(body);
+
+    bool ok = v->is("ca,ev");
+    if (!ok) {
+      delete v;
+      return false;
+    } // if
+
+    std::string callsign = openframe::StringTool::toUpper( v->get("ca") );
+    std::string event = v->get("ev");
+    delete v;
+
+    if (event != "start" && event != "end") return false;
+
+    _store->pushSession(callsign, event == "start", _session_push_ttl);
+
+    TLOG(LogDebug, << "session{push} "
+                   << callsign
+                   << " "
+                   << event
+                   << std::endl);
+
+    return true;
+  } // Worker::process_session
+
   bool Worker::process_message(const std::string &body) {
     openframe::Vars *v = new openframe::Vars(body);
 
@@ -395,6 +1383,14 @@ namespace aprscreate {
       openframe::Stopwatch sw;
       sw.Start();
       bool isSession = _store->isUserSession(pm.target, time(NULL) - _session_expire);
+      if (_store->is_timeout()) {
+        // can't tell either way, don't ack and don't cache the answer
+        TLOG(LogInfo, << "ack{session} "
+                      << pm.target
+                      << " lookup timed out, skipping ack"
+                      << std::endl);
+        return false;
+      } // if
       TLOG((sw.Time() > 1 ? LogWarn : LogDebug),
                     << "ack{session} "
                      << pm.target
@@ -447,16 +1443,116 @@ namespace aprscreate {
     return true;
   } // Worker::event_message_ack
 
+  /*******************
+   ** Create Encode **
+   *******************/
+  // what the encoders need from the worker, copied so the pool
+  // threads never have to touch the worker itself
+  struct create_env_t {
+    std::string aprs_dest;
+    std::string digis;
+  }; // create_env_t
+
+  // Decodes and compiles rows [begin, end) of a pending batch into out.
+  // Encoders must not touch the store, decay or stomp, those are only
+  // safe from the worker thread.
+  template<typename T>
+  class CreateJob : public Job {
+    public:
+      typedef void (*encodeType)(const StoreResult &,
+                                 const openframe::DBI::resultSizeType,
+                                 const create_env_t &,
+                                 T &);
+
+      CreateJob(encodeType encode,
+                const StoreResult &res,
+                const create_env_t &env,
+                std::vector<T> &out,
+                const openframe::DBI::resultSizeType begin,
+                const openframe::DBI::resultSizeType end)
+               : _encode(encode), _res(res), _env(env), _out(out), _begin(begin), _end(end) { }
+      virtual ~CreateJob() { }
+
+      void run() {
+        for(openframe::DBI::resultSizeType i=_begin; i < _end; i++)
+          _encode(_res, i, _env, _out[i]);
+      } // run
+
+    private:
+      encodeType _encode;
+      const StoreResult &_res;
+      const create_env_t &_env;
+      std::vector<T> &_out;
+      openframe::DBI::resultSizeType _begin;
+      openframe::DBI::resultSizeType _end;
+  }; // class CreateJob
+
+  template<typename T>
+  static void encode_batch(JobPool *pool,
+                           const size_t threshold,
+                           typename CreateJob<T>::encodeType encode,
+                           const StoreResult &res,
+                           const create_env_t &env,
+                           std::vector<T> &out) {
+    openframe::DBI::resultSizeType num_rows = res.num_rows();
+    out.resize(num_rows);
+    if (!num_rows) return;
+
+    // small batches aren't worth waking the pool for
+    if (pool == NULL || num_rows < threshold) {
+      CreateJob<T> job(encode, res, env, out, 0, num_rows);
+      job.run();
+      return;
+    } // if
+
+    // a few chunks per thread so one slow chunk doesn't hold up the batch
+    size_t num_jobs = (pool->size() + 1) * 4;
+    openframe::DBI::resultSizeType chunk = (num_rows + num_jobs - 1) / num_jobs;
+
+    JobPool::jobsType jobs;
+    for(openframe::DBI::resultSizeType begin=0; begin < num_rows; begin += chunk) {
+      openframe::DBI::resultSizeType end = std::min(begin + chunk, num_rows);
+      jobs.push_back( new CreateJob<T>(encode, res, env, out, begin, end) );
+    } // for
+
+    pool->run(jobs);
+
+    for(JobPool::jobsType::iterator ptr = jobs.begin(); ptr != jobs.end(); ptr++)
+      delete *ptr;
+  } // encode_batch
+
+  void Worker::report_create(const std::string &name, const size_t num_rows, const double elapsed) {
+    if (num_rows < _create_threshold) return;
+
+    TLOG(LogInfo, << "create{"
+                  << name
+                  << "} encoded "
+                  << num_rows
+                  << " rows in "
+                  << std::fixed << std::setprecision(4)
+                  << elapsed
+                  << "s, "
+                  << std::setprecision(0)
+                  << (elapsed > 0 ? double(num_rows) / elapsed : 0)
+                  << " rows/s using "
+                  << (_pool ? _pool->size() + 1 : 1)
+                  << " threads"
+                  << std::endl);
+  } // Worker::report_create
+
   /**********************
    ** Create Positions **
    **********************/
   struct aprs_position_t {
     bool local;
+    bool ok;
     std::string decay_id;
     std::string status;
     std::string source;
     std::string overlay;
     std::string title;
+    std::string packet;
+    std::string error;
     char symbol_table, symbol_code;
     double latitude, longitude, altitude, speed;
     int course;
@@ -475,79 +1571,138 @@ namespace aprscreate {
     } // while
   } // Worker::handle_decays
 
+  static void encode_position(const StoreResult &res,
+                              const openframe::DBI::resultSizeType i,
+                              const create_env_t &env,
+                              aprs_position_t &p) {
+    // initialize variables
+    p.speed = p.altitude = 0.0;
+    p.course = 0;
+    p.ok = false;
+
+    res[i]["source"].to_string(p.source);
+    p.latitude = atof(res[i]["latitude"].c_str());
+    p.longitude = atof(res[i]["longitude"].c_str());
+    p.symbol_table = *res[i]["symbol_table"].c_str();
+    p.symbol_code = *res[i]["symbol_code"].c_str();
+    p.local = (*res[i]["local"].c_str() == 'Y') ? true : false;
+    p.id = atoi( res[i]["id"].c_str() );
+
+    if ( !res[i]["speed"].is_null() )
+      p.speed = atof(res[i]["speed"].c_str());
+
+    if ( !res[i]["course"].is_null() )
+      p.course = int(atof(res[i]["course"].c_str()));
+
+    if ( !res[i]["altitude"].is_null() )
+      p.altitude = atof( res[i]["altitude"].c_str() );
+
+    if ( !res[i]["status"].is_null() )
+      res[i]["status"].to_string(p.status);
+    else
+      p.status = "";
+
+    aprs::Position *pos;
+    try {
+      pos = new aprs::Position(p.source,
+                               env.aprs_dest,
+                               p.latitude,
+                               p.longitude,
+                               p.symbol_table,
+                               p.symbol_code,
+                               p.course,
+                               p.speed,
+                               p.altitude,
+                               0,
+                               p.status);
+      pos->add_digis(env.digis);
+    } // try
+    catch(aprs::APRS_Exception &ex) {
+      p.error = ex.message();
+      return;
+    } // catch
+
+    if (!p.local) p.packet = pos->compile();
+    p.ok = true;
+
+    delete pos;
+  } // encode_position
+
   unsigned int Worker::create_positions() {
-    openframe::DBI::resultType res;
+    StoreResult res;
     openframe::DBI::resultSizeType num_rows = _store->getPendingPositions(res);
 
     if (!num_rows) return 0;
 
+    create_env_t env;
+    env.aprs_dest = _aprs_dest;
+    env.digis = _digis;
+
+    openframe::Stopwatch sw;
+    sw.Start();
+
+    std::vector<aprs_position_t> positions;
+    encode_batch<aprs_position_t>(_pool, _create_threshold, encode_position, res, env, positions);
+
+    report_create("positions", positions.size(), sw.Time());
+
     unsigned int num_created = 0;
-    for(openframe::DBI::resultSizeType i=0; i < res.num_rows(); i++) {
-      aprs_position_t p;
-
-      // initialize variables
-      p.speed = p.altitude = 0.0;
-      p.course = 0;
-
-      res[i]["source"].to_string(p.source);
-      p.latitude = atof(res[i]["latitude"].c_str());
-      p.longitude = atof(res[i]["longitude"].c_str());
-      p.symbol_table = *res[i]["symbol_table"].c_str();
-      p.symbol_code = *res[i]["symbol_code"].c_str();
-      p.local = (*res[i]["local"].c_str() == 'Y') ? true : false;
-
-      if ( !res[i]["speed"].is_null() )
-        p.speed = atof(res[i]["speed"].c_str());
-
-      if ( !res[i]["course"].is_null() )
-        p.course = int(atof(res[i]["course"].c_str()));
-
-      if ( !res[i]["altitude"].is_null() )
-        p.altitude = atof( res[i]["altitude"].c_str() );
-
-      if ( !res[i]["status"].is_null() )
-        res[i]["status"].to_string(p.status);
-      else
-        p.status = "";
-
-      int id = atoi( res[i]["id"].c_str() );
-      aprs::Position *pos;
-      try {
-        std::string source, status;
-        res[i]["source"].to_string(source);
-        res[i]["status"].to_string(status);
-        pos = new aprs::Position(p.source,
-                                 _aprs_dest,
-                                 p.latitude,
-                                 p.longitude,
-                                 p.symbol_table,
-                                 p.symbol_code,
-                                 p.course,
-                                 p.speed,
-                                 p.altitude,
-                                 0,
-                                 status);
-        pos->add_digis(_digis);
-      } // try
-      catch(aprs::APRS_Exception &ex) {
+    for(std::vector<aprs_position_t>::size_type i=0; i < positions.size(); i++) {
+      aprs_position_t &p = positions[i];
+
+      // store is stalled, leave the rest pending for the next pass
+      if (_store->is_stalled()) break;
+
+      // already out, waiting on the broker to confirm it
+      if (is_unconfirmed(sentTypePosition, p.id)) continue;
+
+      if (!p.ok) {
         TLOG(LogWarn, << "could not create position; "
-                      << ex.message()
+                      << p.error
                       << std::endl);
 
         // Don't keep trying to create the same object over and over
         // if an error occurred in creation.
-        _store->setPositionError(id);
+        _store->setPositionError(p.id);
         continue;
-      } // catch
+      } // if
 
-      bool is_local = *res[i]["local"].c_str() == 'Y';
+      SuppressMe sm;
+      bool suppressing = !p.local && _suppress;
+      if (suppressing) {
+        sm.source = p.source;
+        sm.status = p.status;
+        sm.symbol_table = p.symbol_table;
+        sm.symbol_code = p.symbol_code;
+        sm.latitude = p.latitude;
+        sm.longitude = p.longitude;
+        sm.speed = p.speed;
+        sm.course = p.course;
+        sm.broadcast_ts = time(NULL);
+
+        if (_suppress->is_suppressed(sm)) {
+          // nothing changed worth sending, mark it handled so it isn't
+          // picked up again on the next pass
+          ++_stats.positions_suppressed;
+          ++_stompstats.positions_suppressed;
+          _store->setPositionSent(p.id, time(NULL) );
+          continue;
+        } // if
+      } // if
 
-      if (!is_local) push_aprs( pos->compile() );
-      _store->setPositionSent(id, time(NULL) );
-      num_created++;
+      pushResultEnum pushed = pushResultSent;
+      if (!p.local) {
+        pushed = push_confirmed(p.packet, sentTypePosition, p.id);
+        // didn't go out, it's still pending and still not suppressed
+        if (pushed == pushResultDropped) continue;
+        ++_stats.positions_sent;
+        ++_stompstats.positions_sent;
+      } // if
 
-      delete pos;
-    } // while
+      if (suppressing) _suppress->update(sm);
+      if (pushed == pushResultSent) _store->setPositionSent(p.id, time(NULL) );
+      num_created++;
+    } // for
 
     return num_created;
   } // Worker::create_positions
@@ -557,89 +1712,137 @@ namespace aprscreate {
    *********************/
   struct aprs_message_t {
     bool local;
+    bool ok;
     int id;
     std::string source;
     std::string target;
     std::string message;
+    std::string msgid;
+    std::string body;
     std::string title;
     std::string decay_id;
+    std::string packet;
+    std::string error;
   }; // struct aprs_message_t
 
+  static void encode_message(const StoreResult &res,
+                             const openframe::DBI::resultSizeType i,
+                             const create_env_t &env,
+                             aprs_message_t &m) {
+    m.ok = false;
+
+    // initialize variables
+    res[i]["source"].to_string(m.source);
+    res[i]["target"].to_string(m.target);
+    res[i]["message"].to_string(m.message);
+    m.id = atoi(res[i]["id"].c_str());
+    m.local = (*res[i]["local"].c_str() == 'Y' ? true : false);
+
+    std::stringstream s;
+    s << "Create message \'"
+      << m.message
+      << "\' to "
+      << m.target;
+    m.title = s.str();
+
+    // only tack on msgid if the client might support reply-acks
+    if (m.msgid.length() == 2)
+      m.body = m.message + m.msgid;
+    else
+      m.body = m.message;
+
+    aprs::Message *msg;
+    try {
+      msg = new aprs::Message(m.source,
+                              env.aprs_dest,
+                              m.target,
+                              m.body);
+      msg->add_digis(env.digis);
+    } // try
+    catch(aprs::APRS_Exception &ex) {
+      m.error = ex.message();
+      return;
+    } // catch
+
+    m.packet = msg->compile();
+    m.ok = true;
+    delete msg;
+  } // encode_message
+
   unsigned int Worker::create_messages() {
-    openframe::DBI::resultType res;
+    StoreResult res;
     openframe::DBI::resultSizeType num_rows = _store->getPendingMessages(res);
     if (!num_rows) return 0;
 
-    unsigned int num_created = 0;
+    create_env_t env;
+    env.aprs_dest = _aprs_dest;
+    env.digis = _digis;
+
+    // the last msgid lookup hits the store so it has to happen
+    // here before the batch goes out to be encoded
+    std::vector<aprs_message_t> messages(res.num_rows());
     for(openframe::DBI::resultSizeType i=0; i < res.num_rows(); i++) {
-      aprs_message_t m;
-
-      // initialize variables
-      res[i]["source"].to_string(m.source);
-      res[i]["target"].to_string(m.target);
-      res[i]["message"].to_string(m.message);
-      m.id = atoi(res[i]["id"].c_str());
-      m.local = (*res[i]["local"].c_str() == 'Y' ? true : false);
-
-      std::stringstream s;
-      s << "Create message \'"
-        << m.message
-        << "\' to "
-        << m.target;
-      m.title = s.str();
-
-      // only tack on msgid if the client might support reply-acks
-      std::string msgid;
-      s.str("");
-      if (_store->getLastMessageId(m.target, msgid)
-          && msgid.length() == 2)
-        s << m.message << msgid;
-      else
-        s << m.message;
-
-      aprs::Message *msg;
-      try {
-        msg = new aprs::Message(m.source,
-                                _aprs_dest,
-                                m.target,
-                                s.str());
-        msg->add_digis(_digis);
-      } // try
-      catch(aprs::APRS_Exception &ex) {
+      std::string target;
+      res[i]["target"].to_string(target);
+      _store->getLastMessageId(target, messages[i].msgid);
+    } // for
+
+    // don't send anything we won't be able to mark as sent
+    if (_store->is_stalled()) return 0;
+
+    openframe::Stopwatch sw;
+    sw.Start();
+
+    encode_batch<aprs_message_t>(_pool, _create_threshold, encode_message, res, env, messages);
+
+    report_create("messages", messages.size(), sw.Time());
+
+    unsigned int num_created = 0;
+    for(std::vector<aprs_message_t>::size_type i=0; i < messages.size(); i++) {
+      aprs_message_t &m = messages[i];
+
+      // store is stalled, leave the rest pending for the next pass
+      if (_store->is_stalled()) break;
+
+      // already out, waiting on the broker to confirm it
+      if (is_unconfirmed(sentTypeMessage, m.id)) continue;
+
+      if (!m.ok) {
         TLOG(LogWarn, << "could not create message; "
-                      << ex.message()
+                      << m.error
                       << std::endl);
         _store->setMessageError(m.id);
         continue;
-      } // catch
-
-      std::string pac = msg->compile();
-      delete msg;
+      } // if
 
       TLOG(LogNotice, << "Creating message from "
                       << m.source
                       << " to "
                       << m.target
                       << " with message "
-                      << s.str()
+                      << m.body
                       << std::endl);
 
       if (!m.local) {
+        // didn't go out, it's picked up again without a decay behind it
+        pushResultEnum pushed = push_confirmed(m.packet, sentTypeMessage, m.id);
+        if (pushed == pushResultDropped) continue;
+
         _decay->add(m.source,
                     m.title,
-                    pac,
+                    m.packet,
                     _decay_retry,
                     _decay_timeout,
                     m.decay_id);
 
-        push_aprs(pac);
-        _store->setMessageSent(m.id, m.decay_id, time(NULL) );
+        if (pushed == pushResultSent) _store->setMessageSent(m.id, m.decay_id, time(NULL) );
+        else set_unconfirmed_decay(sentTypeMessage, m.id, m.decay_id);
         setMessageSessionInMemcached(m.source);
 
         num_created++;
       } // if
 
-    } // while
+    } // for
 
     return num_created;
   } // Worker::create_messages
@@ -657,12 +1860,16 @@ namespace aprscreate {
   struct aprs_object_t {
     bool toKill;
     bool local;
+    bool skip;
+    bool ok;
     std::string decay_id;
     std::string name;
     std::string status;
     std::string source;
     std::string overlay;
     std::string title;
+    std::string packet;
+    std::string error;
     char symbol_table, symbol_code;
     double latitude, longitude, altitude, speed;
     int course;
@@ -672,94 +1879,135 @@ namespace aprscreate {
     time_t expire_ts;
   };
 
+  static void encode_object(const StoreResult &res,
+                            const openframe::DBI::resultSizeType i,
+                            const create_env_t &env,
+                            aprs_object_t &o) {
+    o.ok = false;
+    o.id = atoi(res[i]["id"].c_str());
+    o.broadcast_ts = atoi( res[i]["broadcast_ts"].c_str() );
+    o.expire_ts = atoi( res[i]["expire_ts"].c_str() );
+    o.beacon = atoi( res[i]["beacon"].c_str() );
+
+    o.skip = o.broadcast_ts > 0
+             && o.broadcast_ts > (time(NULL) - o.beacon);
+    if (o.skip) return;
+
+    // initialize variables
+    o.speed = o.altitude = 0.0;
+    o.course = 0;
+
+    res[i]["name"].to_string(o.name);
+    res[i]["source"].to_string(o.source);
+    o.latitude = atof( res[i]["latitude"].c_str() );
+    o.longitude = atof( res[i]["longitude"].c_str() );
+    o.symbol_table = *res[i]["symbol_table"].c_str();
+    o.symbol_code = *res[i]["symbol_code"].c_str();
+    res[i]["decay_id"].to_string(o.decay_id);
+    o.local = (res[i]["local"] == "Y") ? true : false;
+
+    if ( !res[i]["speed"].is_null() )
+      o.speed = atof(res[i]["speed"].c_str());
+
+    if ( !res[i]["course"].is_null() )
+      o.course = int(atof(res[i]["course"].c_str()));
+
+    if ( !res[i]["altitude"].is_null() )
+      o.altitude = atof(res[i]["altitude"].c_str());
+
+    if ( !res[i]["status"].is_null() )
+      res[i]["status"].to_string(o.status);
+    else
+      o.status = "";
+
+    o.toKill = (*res[i]["kill"].c_str() == 'Y' ? true : false);
+
+    std::stringstream s;
+    s << (o.toKill != true ? "Create" : "Delete")
+      << " object \'"
+      << o.name
+      << "\'";
+
+    o.title = s.str();
+
+    aprs::Object *obj;
+    try {
+      obj = new aprs::Object(o.source, env.aprs_dest, o.name, o.latitude, o.longitude,
+                             o.symbol_table, o.symbol_code, o.speed,
+                             o.course, o.altitude, 0, o.status, o.toKill, 0);
+      obj->add_digis(env.digis);
+    } // try
+    catch(aprs::APRS_Exception &ex) {
+      o.error = ex.message();
+      return;
+    } // catch
+
+    o.packet = obj->compile();
+    o.ok = true;
+    delete obj;
+  } // encode_object
+
   unsigned int Worker::create_objects() {
-    openframe::DBI::resultType res;
+    StoreResult res;
     openframe::DBI::resultSizeType num_rows = _store->getPendingObjects(time(NULL), res);
     if (!num_rows) return 0;
 
-    unsigned int num_created = 0;
-    for(openframe::DBI::resultSizeType i=0; i < res.num_rows(); i++) {
-      aprs_object_t o;
-      o.id = atoi(res[i]["id"].c_str());
-      o.broadcast_ts = atoi( res[i]["broadcast_ts"].c_str() );
-      o.expire_ts = atoi( res[i]["expire_ts"].c_str() );
-      o.beacon = atoi( res[i]["beacon"].c_str() );
-
-      if (o.broadcast_ts > 0
-          && o.broadcast_ts > (time(NULL) - o.beacon))
-        continue;
+    create_env_t env;
+    env.aprs_dest = _aprs_dest;
+    env.digis = _digis;
 
-      // initialize variables
-      o.speed = o.altitude = 0.0;
-      o.course = 0;
+    openframe::Stopwatch sw;
+    sw.Start();
 
-      res[i]["name"].to_string(o.name);
-      res[i]["source"].to_string(o.source);
-      o.latitude = atof( res[i]["latitude"].c_str() );
-      o.longitude = atof( res[i]["longitude"].c_str() );
-      o.symbol_table = *res[i]["symbol_table"].c_str();
-      o.symbol_code = *res[i]["symbol_code"].c_str();
-      res[i]["decay_id"].to_string(o.decay_id);
-      o.local = (res[i]["local"] == "Y") ? true : false;
+    std::vector<aprs_object_t> objects;
+    encode_batch<aprs_object_t>(_pool, _create_threshold, encode_object, res, env, objects);
 
-      if ( !res[i]["speed"].is_null() )
-        o.speed = atof(res[i]["speed"].c_str());
+    report_create("objects", objects.size(), sw.Time());
 
-      if ( !res[i]["course"].is_null() )
-        o.course = int(atof(res[i]["course"].c_str()));
+    unsigned int num_created = 0;
+    for(std::vector<aprs_object_t>::size_type i=0; i < objects.size(); i++) {
+      aprs_object_t &o = objects[i];
 
-      if ( !res[i]["altitude"].is_null() )
-        o.altitude = atof(res[i]["altitude"].c_str());
+      // store is stalled, leave the rest pending for the next pass
+      if (_store->is_stalled()) break;
 
-      if ( !res[i]["status"].is_null() )
-        res[i]["status"].to_string(o.status);
-      else
-        o.status = "";
+      // already out, waiting on the broker to confirm it
+      if (is_unconfirmed(sentTypeObject, o.id)) continue;
 
-      o.toKill = (*res[i]["kill"].c_str() == 'Y' ? true : false);
+      if (o.skip) continue;
 
       // remove any decays for this object
       std::string decayId;
       if (_store->getObjectDecayId(o.name, time(NULL) - 14400, decayId))
         _decay->remove(decayId);
 
-      std::stringstream s;
-      s << (o.toKill != true ? "Create" : "Delete")
-        << " object \'"
-        << o.name
-        << "\'";
-
-      o.title = s.str();
-
-      aprs::Object *obj;
-      try {
-        obj = new aprs::Object(o.source, _aprs_dest, o.name, o.latitude, o.longitude,
-                               o.symbol_table, o.symbol_code, o.speed,
-                               o.course, o.altitude, 0, o.status, o.toKill, 0);
-        obj->add_digis(_digis);
-      } // try
-      catch(aprs::APRS_Exception &ex) {
+      // the lookup timed out, setObjectSent would fail fast after the send
+      if (_store->is_stalled()) break;
+
+      if (!o.ok) {
         TLOG(LogWarn, << "could not create object; "
-                      << ex.message()
+                      << o.error
                       << std::endl);
 
         // Don't keep trying to create the same object over and over
         // if an error occurred in creation.
         _store->setObjectError(o.id);
         continue;
-      } // catch
+      } // if
 
-      std::string pac = obj->compile();
+      pushResultEnum pushed = pushResultSent;
       if (!o.local) {
-        if (o.broadcast_ts == 0)
-          _decay->add(o.source, o.title, pac, 30, 300, o.decay_id);
+        pushed = push_confirmed(o.packet, sentTypeObject, o.id);
+        if (pushed == pushResultDropped) continue;
 
-        push_aprs(pac);
+        if (o.broadcast_ts == 0)
+          _decay->add(o.source, o.title, o.packet, 30, 300, o.decay_id);
+        if (pushed == pushResultQueued) set_unconfirmed_decay(sentTypeObject, o.id, o.decay_id);
       } // if
 
-      _store->setObjectSent(o.id, o.decay_id, time(NULL) );
+      if (pushed == pushResultSent) _store->setObjectSent(o.id, o.decay_id, time(NULL) );
       num_created++;
-    } // while
+    } // for
 
     return num_created;
   } // Worker::create_objects
@@ -0,0 +1,95 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <cassert>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <openframe/openframe.h>
+
+#include <CircuitBreaker.h>
+
+using namespace aprscreate;
+
+int main(int argc, char **argv) {
+  CircuitBreaker::breaker_opts_t opts;
+  CircuitBreaker::init_opts(opts);
+  opts.error_rate = 50;
+  opts.slow = 0.1;
+  opts.window = 10;
+  opts.min_calls = 4;
+  opts.backoff = 0.1;
+  opts.backoff_max = 0.4;
+  opts.trials = 2;
+
+  CircuitBreaker breaker(0, "test");
+  breaker.set_opts(opts);
+  assert(breaker.state() == CircuitBreaker::breakerStateClosed);
+
+  // too few calls to judge
+  breaker.record(false, 0);
+  breaker.record(false, 0);
+  breaker.record(false, 0);
+  assert(breaker.state() == CircuitBreaker::breakerStateClosed);
+
+  // slow counts as failed, 4 of 4 trips it
+  breaker.record(true, 0.5);
+  assert(breaker.state() == CircuitBreaker::breakerStateOpen);
+  assert(breaker.trips() == 1);
+  assert(!breaker.allow());
+
+  // after the backoff only the trial calls get through
+  usleep(150000);
+  assert(breaker.allow());
+  assert(breaker.state() == CircuitBreaker::breakerStateHalfOpen);
+  assert(breaker.allow());
+  assert(!breaker.allow());
+
+  // a failed trial opens it again for twice as long
+  breaker.record(false, 0);
+  assert(breaker.state() == CircuitBreaker::breakerStateOpen);
+  assert(breaker.trips() == 2);
+  usleep(150000);
+  assert(!breaker.allow());
+  usleep(100000);
+  assert(breaker.allow());
+
+  // enough good trials close it
+  breaker.record(true, 0);
+  assert(breaker.state() == CircuitBreaker::breakerStateHalfOpen);
+  assert(breaker.allow());
+  breaker.record(true, 0);
+  assert(breaker.state() == CircuitBreaker::breakerStateClosed);
+  assert(breaker.allow());
+
+  // under the error rate stays closed
+  for(int i=0; i < 10; i++)
+    breaker.record(i % 4 != 3, 0);
+  assert(breaker.state() == CircuitBreaker::breakerStateClosed);
+
+  printf("ok\n");
+  return 0;
+} // main
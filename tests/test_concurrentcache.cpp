@@ -0,0 +1,91 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <cassert>
+#include <cstdio>
+
+#include <pthread.h>
+
+#include <ConcurrentCache.h>
+
+using namespace aprscreate;
+
+  static ConcurrentCache shared(8, 64);
+
+  static void *hammer(void *arg) {
+    long n = (long) arg;
+    char key[32];
+    std::string value;
+    for(int i=0; i < 20000; i++) {
+      snprintf(key, sizeof(key), "K%ld-%d", n, i % 100);
+      shared.put("ack", key, "x", 60);
+      shared.get("ack", key, value);
+    } // for
+    return NULL;
+  } // hammer
+
+int main(int argc, char **argv) {
+  ConcurrentCache cache(1, 3);
+  std::string value;
+
+  cache.put("ack", "A", "1", 60);
+  cache.put("ack", "B", "2", 60);
+  cache.put("ack", "C", "3", 60);
+
+  // an overwrite of a full shard evicts nothing and makes A the newest
+  cache.put("ack", "A", "4", 60);
+  assert(cache.size() == 3);
+  assert(cache.get("ack", "A", value) && value == "4");
+
+  // B is now the oldest write
+  cache.put("ack", "D", "5", 60);
+  assert(cache.size() == 3);
+  assert(!cache.get("ack", "B", value));
+  assert(cache.get("ack", "A", value));
+
+  // reading doesn't count, C goes next
+  assert(cache.get("ack", "C", value));
+  cache.put("ack", "E", "6", 60);
+  assert(!cache.get("ack", "C", value));
+  assert(cache.get("ack", "D", value) && cache.get("ack", "E", value));
+
+  // namespaces don't see each other
+  assert(!cache.get("written", "A", value));
+  cache.erase("ack", "A");
+  assert(!cache.get("ack", "A", value));
+
+  cache.put("ack", "F", "7", 0);
+  assert(!cache.get("ack", "F", value));
+
+  pthread_t threads[4];
+  for(long i=0; i < 4; i++)
+    pthread_create(&threads[i], NULL, hammer, (void *) i);
+  for(int i=0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  assert(shared.size() <= 64);
+
+  printf("ok\n");
+  return 0;
+} // main
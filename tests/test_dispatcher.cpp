@@ -0,0 +1,128 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <cassert>
+#include <cstdio>
+
+#include <Dispatcher.h>
+
+using namespace aprscreate;
+
+  // a key that hashes to shard, found on a dispatcher that never moves keys
+  static std::string key_for(const unsigned int num_shards, const unsigned int shard) {
+    Dispatcher probe(num_shards, 0);
+    char key[32];
+    for(int i=0; ; i++) {
+      snprintf(key, sizeof(key), "K%d", i);
+      if (probe.push(key, "") == shard) return key;
+    } // for
+  } // key_for
+
+  static std::string bodies(const Dispatcher::entriesType &entries) {
+    std::string ret;
+    for(Dispatcher::entriesType::const_iterator ptr = entries.begin(); ptr != entries.end(); ptr++)
+      ret += ptr->body;
+    return ret;
+  } // bodies
+
+int main(int argc, char **argv) {
+  Dispatcher::entriesType entries;
+  Dispatcher::acksType acks;
+
+  // steal takes a whole idle key from the deepest shard, in order
+  Dispatcher d(2, 0);
+  unsigned int a = d.push("A", "1");
+  unsigned int b = 1 - a;
+  d.push("A", "2");
+  d.push("A", "3");
+  assert(d.depth(a) == 3);
+  assert(d.steal(b) == 3);
+  assert(d.depth(a) == 0 && d.depth(b) == 3);
+
+  // and the key follows it until it's done there
+  assert(d.push("A", "4") == b);
+  assert(d.pop(b, entries, 10) == 4);
+  assert(bodies(entries) == "1234");
+  d.done(b, entries);
+  entries.clear();
+  assert(d.push("A", "5") == a);
+  d.pop(a, entries, 10);
+  d.done(a, entries);
+  entries.clear();
+
+  // a key with some of it being worked on stays where it is
+  d.push("A", "1");
+  d.push("A", "2");
+  d.push("A", "3");
+  assert(d.pop(a, entries, 1) == 1);
+  assert(d.steal(b) == 0);
+  d.done(a, entries);
+  entries.clear();
+  assert(d.steal(b) == 2);
+  d.pop(b, entries, 10);
+  assert(bodies(entries) == "23");
+  d.done(b, entries);
+  entries.clear();
+
+  // nothing worth taking from a shard with one entry
+  d.push("A", "1");
+  assert(d.steal(b) == 0);
+  d.pop(a, entries, 10);
+  d.done(a, entries);
+  entries.clear();
+
+  // acks come back once the entry is done
+  Dispatcher::dispatch_ack_t ack;
+  ack.message_id = "ID:1";
+  ack.subscription = "1";
+  ack.generation = 7;
+  unsigned int s = d.push("B", "1", 0, ack);
+  d.pop(s, entries, 10);
+  assert(d.finished(acks) == 0);
+  d.done(s, entries);
+  entries.clear();
+  assert(d.finished(acks) == 1);
+  assert(acks[0].message_id == "ID:1" && acks[0].generation == 7);
+
+  // a backed up shard hands new keys to the least busy one
+  Dispatcher r(2, 4);
+  a = r.push("A", "1");
+  b = 1 - a;
+  r.push("A", "2");
+  r.push("A", "3");
+  r.push("A", "4");
+  std::string key = key_for(2, a);
+  assert(r.push(key, "1") == b);
+  assert(r.push(key, "2") == b);
+  // a key already queued keeps its order
+  assert(r.push("A", "5") == a);
+
+  Dispatcher::dispatch_stats_t stats;
+  r.stats(b, stats);
+  assert(stats.moved == 1);
+
+  printf("ok\n");
+  return 0;
+} // main
@@ -0,0 +1,80 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <cassert>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <LruCache.h>
+
+using namespace aprscreate;
+
+int main(int argc, char **argv) {
+  LruCache l1(3);
+  std::string value;
+
+  assert(l1.get("A", value) == LruCache::lruResultMiss);
+
+  l1.put("A", "1", 60);
+  l1.put_negative("B", 60);
+  assert(l1.get("A", value) == LruCache::lruResultPositive && value == "1");
+  assert(l1.get("B", value) == LruCache::lruResultNegative);
+
+  // overwrite replaces, doesn't grow
+  l1.put("A", "2", 60);
+  assert(l1.size() == 2);
+  assert(l1.get("A", value) == LruCache::lruResultPositive && value == "2");
+
+  // C is least recently used once A and B have been read
+  l1.put("C", "3", 60);
+  assert(l1.get("A", value) == LruCache::lruResultPositive);
+  assert(l1.get("B", value) == LruCache::lruResultNegative);
+  l1.put("D", "4", 60);
+  assert(l1.size() == 3);
+  assert(l1.evicted() == 1);
+  assert(l1.get("C", value) == LruCache::lruResultMiss);
+  assert(l1.get("D", value) == LruCache::lruResultPositive && value == "4");
+
+  l1.erase("D");
+  assert(l1.get("D", value) == LruCache::lruResultMiss);
+
+  // no ttl or no room stores nothing
+  l1.put("E", "5", 0);
+  assert(l1.get("E", value) == LruCache::lruResultMiss);
+  LruCache none(0);
+  none.put("A", "1", 60);
+  assert(none.size() == 0);
+
+  l1.put("F", "6", 1);
+  sleep(1);
+  assert(l1.get("F", value) == LruCache::lruResultMiss);
+
+  l1.clear();
+  assert(l1.size() == 0);
+
+  printf("ok\n");
+  return 0;
+} // main
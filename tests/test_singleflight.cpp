@@ -0,0 +1,106 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <cassert>
+#include <cstdio>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <SingleFlight.h>
+
+using namespace aprscreate;
+
+  struct follower_t {
+    SingleFlight *flights;
+    SingleFlight::flight_t *flight;
+    double timeout;
+    bool ok;
+    std::string value;
+    double waited;
+  }; // follower_t
+
+  static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + double(tv.tv_usec) / 1000000;
+  } // now
+
+  static void *follow(void *arg) {
+    follower_t *f = static_cast<follower_t *>(arg);
+    double start = now();
+    f->ok = f->flights->wait(f->flight, f->value, f->timeout);
+    f->waited = now() - start;
+    return NULL;
+  } // follow
+
+  // joins as a follower of a flight that's already up and waits on its own thread
+  static void start_follower(SingleFlight &flights, const std::string &key, const double timeout,
+                             follower_t &f, pthread_t &thread) {
+    f.flights = &flights;
+    f.timeout = timeout;
+    f.ok = false;
+    f.waited = 0;
+    assert(!flights.join(key, f.flight));
+    pthread_create(&thread, NULL, follow, &f);
+  } // start_follower
+
+int main(int argc, char **argv) {
+  SingleFlight flights;
+  SingleFlight::flight_t *leader;
+  follower_t f;
+  pthread_t thread;
+
+  // the answer is handed to whoever waited
+  assert(flights.join("session:N0CALL", leader));
+  start_follower(flights, "session:N0CALL", 5, f, thread);
+  usleep(50000);
+  flights.finish(leader, "1", true);
+  pthread_join(thread, NULL);
+  assert(f.ok && f.value == "1");
+
+  // the leader threw, waiters hear about it right away instead of timing out
+  assert(flights.join("session:N0CALL", leader));
+  start_follower(flights, "session:N0CALL", 5, f, thread);
+  usleep(50000);
+  flights.finish(leader, "", false);
+  pthread_join(thread, NULL);
+  assert(!f.ok && f.waited < 1);
+
+  // a leader that takes too long, the wait gives up on its own
+  assert(flights.join("session:N0CALL", leader));
+  start_follower(flights, "session:N0CALL", 0.2, f, thread);
+  pthread_join(thread, NULL);
+  assert(!f.ok && f.waited >= 0.15 && f.waited < 2);
+
+  // the leader still finishes, the next caller leads a fresh flight
+  flights.finish(leader, "1", true);
+  assert(flights.join("session:N0CALL", leader));
+  flights.finish(leader, "0", true);
+
+  printf("ok\n");
+  return 0;
+} // main
@@ -0,0 +1,95 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <cassert>
+#include <cstdio>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <SpscRing.h>
+
+using namespace aprscreate;
+
+  static const unsigned long kNumItems = 100000;
+
+  static void *produce(void *arg) {
+    SpscRing<unsigned long> *ring = static_cast<SpscRing<unsigned long> *>(arg);
+    for(unsigned long i=1; i <= kNumItems; i++) {
+      // let the reader have the cpu, a busy wait crawls on one core
+      while(!ring->push(i)) sched_yield();
+    } // for
+    return NULL;
+  } // produce
+
+int main(int argc, char **argv) {
+  SpscRing<int> ring(5);
+  int value;
+
+  // rounded up to a power of two
+  assert(ring.capacity() == 8);
+  assert(ring.empty());
+  assert(!ring.pop(value));
+  assert(!ring.peek(value));
+
+  for(int i=0; i < 8; i++)
+    assert(ring.push(i));
+  assert(!ring.push(8));
+  assert(ring.size() == 8);
+
+  // peek leaves it there
+  assert(ring.peek(value) && value == 0);
+  assert(ring.size() == 8);
+
+  for(int i=0; i < 8; i++)
+    assert(ring.pop(value) && value == i);
+  assert(ring.empty());
+
+  // wraps around the end of the buffer
+  for(int i=0; i < 20; i++) {
+    assert(ring.push(i));
+    assert(ring.pop(value) && value == i);
+  } // for
+
+  // one thread each way, everything arrives once and in order
+  SpscRing<unsigned long> shared(64);
+  pthread_t producer;
+  pthread_create(&producer, NULL, produce, &shared);
+
+  unsigned long next = 1;
+  unsigned long got;
+  while(next <= kNumItems) {
+    if (!shared.pop(got)) {
+      sched_yield();
+      continue;
+    } // if
+    assert(got == next);
+    next++;
+  } // while
+  pthread_join(producer, NULL);
+  assert(shared.empty());
+
+  printf("ok\n");
+  return 0;
+} // main
@@ -0,0 +1,86 @@
+/**************************************************************************
+ ** Dynamic Networking Solutions                                         **
+ **************************************************************************
+ ** OpenAPRS, Internet APRS MySQL Injector                               **
+ ** Copyright (C) 1999 Gregory A. Carter                                 **
+ **                    Dynamic Networking Solutions                      **
+ **                                                                      **
+ ** This program is free software; you can redistribute it and/or modify **
+ ** it under the terms of the GNU General Public License as published by **
+ ** the Free Software Foundation; either version 1, or (at your option)  **
+ ** any later version.                                                   **
+ **                                                                      **
+ ** This program is distributed in the hope that it will be useful,      **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of       **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        **
+ ** GNU General Public License for more details.                         **
+ **                                                                      **
+ ** You should have received a copy of the GNU General Public License    **
+ ** along with this program; if not, write to the Free Software          **
+ ** Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.            **
+ **************************************************************************/
+
+#include "config.h"
+
+#include <string>
+#include <cassert>
+#include <cstdio>
+
+#include <openframe/openframe.h>
+
+#include <Suppress.h>
+
+using namespace aprscreate;
+
+  static SuppressMe at(const double latitude, const double longitude, const int course) {
+    SuppressMe p;
+    p.source = "N0CALL";
+    p.status = "";
+    p.symbol_table = '/';
+    p.symbol_code = '>';
+    p.latitude = latitude;
+    p.longitude = longitude;
+    p.speed = 30;
+    p.course = course;
+    p.broadcast_ts = time(NULL);
+    return p;
+  } // at
+
+int main(int argc, char **argv) {
+  Suppress suppress;
+  suppress.set_distance(50)
+          .set_course(15)
+          .set_speed(5)
+          .set_interval(1800);
+
+  // nothing sent yet
+  assert( !suppress.is_suppressed( at(45.0, -93.0, 90) ) );
+  suppress.update( at(45.0, -93.0, 90) );
+  assert(suppress.size() == 1);
+
+  // about 33m north, 111m north
+  assert( suppress.is_suppressed( at(45.0003, -93.0, 90) ) );
+  assert( !suppress.is_suppressed( at(45.001, -93.0, 90) ) );
+
+  // great circle, a degree of latitude is about 111km
+  double d = Suppress::distance(45.0, -93.0, 46.0, -93.0);
+  assert(d > 111000 && d < 111400);
+  assert(Suppress::distance(45.0, -93.0, 45.0, -93.0) == 0);
+
+  // 350 to 5 is 15 degrees across north, not 345
+  suppress.update( at(45.0, -93.0, 350) );
+  assert( suppress.is_suppressed( at(45.0, -93.0, 5) ) );
+  assert( !suppress.is_suppressed( at(45.0, -93.0, 10) ) );
+  assert( !suppress.is_suppressed( at(45.0, -93.0, 170) ) );
+
+  // quiet for longer than the interval goes out anyway
+  SuppressMe old = at(45.0, -93.0, 350);
+  old.broadcast_ts = time(NULL) - 3600;
+  suppress.update(old);
+  assert( !suppress.is_suppressed( at(45.0, -93.0, 350) ) );
+  assert(suppress.expire() == 1);
+  assert(suppress.size() == 0);
+
+  printf("ok\n");
+  return 0;
+} // main